@@ -0,0 +1,34 @@
+# Prints the largest stack frames recorded by -fstack-usage in the .su files
+# below DIR, at most COUNT of them (default 20).
+if(NOT DEFINED COUNT)
+	set(COUNT 20)
+endif()
+
+file(GLOB_RECURSE su_files "${DIR}/*.su")
+set(frames)
+foreach(su_file IN LISTS su_files)
+	file(STRINGS "${su_file}" lines)
+	foreach(line IN LISTS lines)
+		# <file>:<line>:<column>:<function>\t<bytes>\t<static|dynamic|bounded>
+		if(line MATCHES "^(.*)\t([0-9]+)\t(.*)$")
+			# zero padded so that the frames sort numerically
+			string(LENGTH "${CMAKE_MATCH_2}" digits)
+			math(EXPR padding "10 - ${digits}")
+			string(REPEAT "0" ${padding} zeros)
+			list(APPEND frames "${zeros}${CMAKE_MATCH_2}\t${CMAKE_MATCH_3}\t${CMAKE_MATCH_1}")
+		endif()
+	endforeach()
+endforeach()
+
+list(SORT frames ORDER DESCENDING)
+list(LENGTH frames total)
+message("stack usage, largest ${COUNT} of ${total} functions (bytes):")
+set(i 0)
+foreach(frame IN LISTS frames)
+	if(i EQUAL COUNT)
+		break()
+	endif()
+	string(REGEX MATCH "^0*([0-9]+)\t([^\t]*)\t(.*)$" _ "${frame}")
+	message("  ${CMAKE_MATCH_1} (${CMAKE_MATCH_2}) ${CMAKE_MATCH_3}")
+	math(EXPR i "${i} + 1")
+endforeach()
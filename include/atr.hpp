@@ -1,17 +1,87 @@
 #ifndef atr_header_
 #define atr_header_
 
+#include <array>
 #include <chrono>
 #include <cstddef>
-#include <functional>
+#include <cstdint>
 #include <gsl/span>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+
+// Freestanding builds (ATR_FREESTANDING) work without exceptions, RTTI and
+// dynamic allocation: only atr_view::parse() reports invalid ATRs there.
+#ifndef ATR_FREESTANDING
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
 #include <vector>
+#endif
 
 namespace atr {
 
+// rules an ATR is rejected for, EMV rules are prefixed with emv_
+enum class rule : std::uint8_t {
+  none,
+  // structure
+  structure,
+  too_many_interface_bytes,
+  historical_bytes_missing,
+  tck_absent,
+  invalid_tck,
+  too_many_bytes,
+  // ISO7816-3 interface bytes
+  invalid_Fi,
+  invalid_Di,
+  TA2_rfu,
+  invalid_WI,
+  invalid_ifsc,
+  invalid_bwi,
+  invalid_T1_TC,
+  invalid_classes,
+  // EMV Book 1
+  emv_TS,
+  emv_TA1,
+  emv_TB1,
+  emv_TB1_absent,
+  emv_TD1,
+  emv_TA2_mode,
+  emv_TA2_divider,
+  emv_TB2,
+  emv_TC2,
+  emv_TD2,
+  emv_TD2_T1,
+  emv_ifsc,
+  emv_bwi,
+  emv_cwi,
+  emv_cwt,
+  emv_TB_T1_absent,
+  emv_lrc,
+};
+constexpr std::size_t rule_count = static_cast<std::size_t>(rule::emv_lrc) + 1;
+
+// description of the rule, also used as message of invalid_atr
+const char *message(rule r) noexcept;
+
+// rules as std::error_code of the category "atr", rule::none is no error
+const std::error_category &atr_category() noexcept;
+std::error_code make_error_code(rule r) noexcept;
+
+#ifndef ATR_FREESTANDING
 class invalid_atr : public std::runtime_error {
+  rule reason_ = rule::none;
+
+public:
   using std::runtime_error::runtime_error;
+  invalid_atr(rule reason, const std::string &what)
+      : std::runtime_error(what), reason_(reason) {}
+
+  rule reason() const noexcept { return reason_; }
 };
+#endif
 
 enum class if_char { A = 0x10, B = 0x20, C = 0x40, D = 0x80 };
 enum class protocol_state { PPS, T0, T1 };
@@ -23,6 +93,9 @@ enum class clockstop_indicator {
 };
 enum class operating_condition : uint8_t { A = 0x01, B = 0x02, C = 0x04 };
 enum class redundancy_code { CRC, LRC };
+// set of rules an ATR is validated against, EMV applies the rules of EMV
+// Book 1 on top of the ISO7816-3 rules
+enum class profile { ISO7816, EMV };
 
 constexpr inline char to_char(if_char c) {
   switch (c) {
@@ -50,10 +123,21 @@ constexpr inline operating_condition operator|(operating_condition a,
                                           static_cast<uint8_t>(b));
 }
 
-// TODO EMVco mode
-class atr {
-  std::vector<std::byte> bytes_;
-  std::vector<std::byte> historical_bytes_;
+constexpr std::size_t max_atr_size = 32;
+
+struct scan_result;
+
+// Validated ATR over borrowed bytes, the bytes have to outlive the view.
+// Parsing and all accessors work without allocating.
+class atr_view {
+  gsl::span<const std::byte> bytes_;
+  // offsets of T0/TDi in bytes_, i.e. of the byte indicating the presence of
+  // the interface bytes of block i+1
+  std::array<std::uint8_t, max_atr_size> td_offsets_;
+  std::uint8_t blocks_ = 0;
+  std::uint8_t historical_offset_ = 0;
+  std::uint8_t historical_size_ = 0;
+  bool emv_compliant_ = true;
   int Fi_;
   int FMax_;
   int Di_;
@@ -61,14 +145,35 @@ class atr {
 public:
   using duration = std::chrono::duration<double, std::ratio<1>>;
 
-  explicit atr(std::vector<std::byte> bytes);
+  // outputs of sweep(), empty spans are skipped
+  struct timings {
+    gsl::span<duration> gt;
+    gsl::span<duration> wt;
+    gsl::span<duration> cwt;
+    gsl::span<duration> bwt;
+  };
+
+  // EMV rules are always evaluated, but only cause an exception if the EMV
+  // profile is requested. Use emv_compliant() for the EMV verdict otherwise.
+#ifndef ATR_FREESTANDING
+  explicit atr_view(gsl::span<const std::byte> bytes,
+                    profile p = profile::ISO7816);
+#endif
+  // Same as the constructor, but reports the violated rule in ec instead of
+  // throwing. Returns nullopt if the ATR is invalid.
+  static std::optional<atr_view> parse(gsl::span<const std::byte> bytes,
+                                       std::error_code &ec,
+                                       profile p = profile::ISO7816) noexcept;
+  atr_view(const atr_view &) = default;
 
-  const std::vector<std::byte> &bytes() const { return bytes_; }
+  gsl::span<const std::byte> bytes() const noexcept { return bytes_; }
   std::optional<std::byte> intf_char(if_char c, int idx) const noexcept;
   std::optional<std::byte> first(if_char c, int T) const noexcept;
 
   bool T_present(int i) const noexcept;
-  const std::vector<std::byte> &historical_bytes() const noexcept;
+  gsl::span<const std::byte> historical_bytes() const noexcept {
+    return bytes_.subspan(historical_offset_, historical_size_);
+  }
 
   int Fi() const noexcept;
   int FMax() const noexcept;
@@ -95,13 +200,144 @@ public:
   duration bwt(int F, int D, int freq) const noexcept;
   redundancy_code code() const noexcept;
 
+  // Evaluates gt, wt, cwt and bwt for F[i], D[i] and freq[i] of all points i
+  // at once. The ATR is decoded a single time, the loops over the points are
+  // branch free so that the compiler can vectorize them. Only the points
+  // present in all inputs and the requested output are evaluated.
+  void sweep(gsl::span<const int> F, gsl::span<const int> D,
+             gsl::span<const int> freq, const timings &out) const noexcept;
+
+  // EMV Book 1 defines no defaults of its own for the values above: absent
+  // TA1 means Fi=372/Di=1, absent TC1 N=0, absent TC2 WI=10 (the only value
+  // EMV allows) and the T=1 TB is mandatory. The accessors are therefore
+  // valid for both profiles.
+  bool emv_compliant() const noexcept { return emv_compliant_; }
+
+protected:
+  atr_view() = default;
+  // only atr reassigns its view, together with the bytes it owns, so that a
+  // view can not be replaced behind the back of its atr
+  atr_view &operator=(const atr_view &) = default;
+  // moves the view to a copy of the viewed bytes
+  void rebind(gsl::span<const std::byte> bytes) noexcept { bytes_ = bytes; }
+  // views no bytes, as if default constructed
+  void clear() noexcept { *this = atr_view(); }
+
 private:
+  // apply_rules() and the metrics hooks
+  rule validate(profile p) noexcept;
+  rule apply_rules(profile p) noexcept;
+  // parse() without the metrics hooks, for the speculative parsing of scan()
+  static std::optional<atr_view> decode(gsl::span<const std::byte> bytes,
+                                        profile p) noexcept;
+  friend scan_result scan(gsl::span<const std::byte> buffered, profile p,
+                          bool end_of_stream) noexcept;
   constexpr std::size_t offset(std::byte tdx, if_char c) const noexcept;
   constexpr double etu(int F, int D, int freq) const noexcept;
 };
 
-std::vector<std::byte>
-receive(std::function<bool(gsl::span<std::byte> buffer)> recv_func);
+#ifndef ATR_FREESTANDING
+// ATR owning its bytes. Slicing it to an atr_view yields a view of these.
+class atr : public atr_view {
+  std::pmr::vector<std::byte> bytes_;
+  std::pmr::vector<std::byte> historical_bytes_;
+
+public:
+  // all storage of the ATR is obtained from this allocator
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  explicit atr(gsl::span<const std::byte> bytes, profile p = profile::ISO7816,
+               const allocator_type &alloc = {});
+  // uses-allocator construction, e.g. by std::pmr containers
+  atr(std::allocator_arg_t, const allocator_type &alloc,
+      gsl::span<const std::byte> bytes, profile p = profile::ISO7816);
+  // takes over bytes, using its allocator for the historical bytes as well
+  explicit atr(std::pmr::vector<std::byte> bytes,
+               profile p = profile::ISO7816);
+  // copies the bytes of an already validated view
+  explicit atr(const atr_view &view, const allocator_type &alloc = {});
+
+  atr(const atr &other);
+  atr(atr &&other) noexcept;
+  atr(const atr &other, const allocator_type &alloc);
+  atr(atr &&other, const allocator_type &alloc);
+  atr &operator=(const atr &other);
+  atr &operator=(atr &&other);
+
+  allocator_type get_allocator() const noexcept {
+    return bytes_.get_allocator();
+  }
+
+  const std::pmr::vector<std::byte> &bytes() const noexcept { return bytes_; }
+  const std::pmr::vector<std::byte> &historical_bytes() const noexcept {
+    return historical_bytes_;
+  }
+
+private:
+  // leaves a moved-from atr empty, viewing its own storage
+  void reset() noexcept;
+};
+
+#endif
+
+// Returns the size of the ATR starting at received[0] as far as it can be
+// determined from the bytes received so far. Once received.size() is at
+// least the returned value, the value is the final ATR size.
+// Returns 0 if the bytes can not be the start of a valid ATR.
+std::size_t expected_size(gsl::span<const std::byte> received);
+
+struct scan_result {
+  std::optional<atr_view> atr; // views the scanned bytes
+  std::size_t skipped = 0;     // bytes before atr
+};
+
+// Finds an ATR in buffered bytes that may start with line noise or leftover
+// bytes, so that a glitch does not require another reset of the card. Every
+// TS candidate (3B or 3F) is validated speculatively: T0/TD chain, K, TCK and
+// finally all rules of the profile. Returns the first valid ATR found.
+// Scanning stops at the first candidate that might still become a valid ATR
+// with more bytes, an ATR within its bytes could be part of it. Without an
+// ATR, skipped is the offset of that candidate (or all bytes if there is
+// none): these bytes can be dropped before scanning again with more bytes
+// appended. Once no more bytes will arrive (e.g. the line is idle for longer
+// than the character waiting time), scanning again with end_of_stream skips
+// incomplete candidates, so that a stray TS does not hide a later ATR.
+// Only the returned ATR is counted by the metrics.
+scan_result scan(gsl::span<const std::byte> buffered,
+                 profile p = profile::ISO7816,
+                 bool end_of_stream = false) noexcept;
+
+#ifndef ATR_FREESTANDING
+// the returned ATR is allocated from alloc
+std::pmr::vector<std::byte>
+receive(std::function<bool(gsl::span<std::byte> buffer)> recv_func,
+        const std::pmr::polymorphic_allocator<std::byte> &alloc = {});
+
+// Receives ATRs from readers that return whatever is currently available
+// instead of exactly the requested number of bytes. The read function is
+// passed the free buffer space and returns the number of bytes it stored
+// there, 0 signals a failure/timeout.
+// Bytes received after the end of the ATR are kept and can be retrieved via
+// pending().
+class receiver {
+public:
+  using read_function = std::function<std::size_t(gsl::span<std::byte>)>;
+
+  explicit receiver(read_function read_func);
+
+  // writes the ATR to the start of buffer, returns the used part of it or an
+  // empty span on error (in which case all buffered bytes are dropped)
+  gsl::span<std::byte> receive(gsl::span<std::byte> buffer);
+
+  gsl::span<const std::byte> pending() const noexcept;
+  void reset() noexcept;
+
+private:
+  read_function read_func_;
+  std::array<std::byte, 2 * max_atr_size> buffer_;
+  std::size_t begin_ = 0;
+  std::size_t end_ = 0;
+};
 
 bool iterate(gsl::span<const std::byte> &atr,
              std::function<void(if_char, std::size_t, std::byte)> func);
@@ -110,7 +346,12 @@ bool iterate(
     std::function<void(if_char, std::size_t, std::byte)> global,
     std::function<void(std::byte T, if_char c, std::size_t n, std::byte b)>
         specific);
+#endif
 
 } // namespace atr
 
+namespace std {
+template <> struct is_error_code_enum<atr::rule> : true_type {};
+} // namespace std
+
 #endif
@@ -0,0 +1,105 @@
+#ifndef atr_dispatch_header_
+#define atr_dispatch_header_
+
+#include "atr.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <gsl/span>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace atr {
+
+// Parses ATRs of many readers on a pool of worker threads.
+//
+// Every reader has a single producer ring of raw ATRs, submit() for a reader
+// must only be called from one thread at a time. Readers are distributed over
+// the workers, an idle worker steals from the readers of the others. Results
+// are published to a bounded lock-free queue, which is drained by a single
+// consumer via poll(). Results of one reader may be completed out of order,
+// the sequence number restores the order of submission.
+// Workers without work and workers blocked by a full queue spin briefly and
+// then sleep until submit() or poll() wakes them.
+class dispatcher {
+public:
+  struct completion {
+    std::size_t reader;
+    std::uint64_t sequence; // per reader, counting calls to submit()
+    std::optional<atr> result;
+    std::string error; // reason if the ATR was rejected
+  };
+
+  dispatcher(std::size_t readers, std::size_t workers,
+             profile p = profile::ISO7816, std::size_t ring_size = 64,
+             std::size_t completion_size = 1024);
+  ~dispatcher();
+  dispatcher(const dispatcher &) = delete;
+  dispatcher &operator=(const dispatcher &) = delete;
+
+  // false if the ring of the reader is full or the ATR is too long
+  bool submit(std::size_t reader, gsl::span<const std::byte> bytes);
+  std::optional<completion> poll();
+
+  std::size_t readers() const noexcept { return readers_; }
+  std::size_t workers() const noexcept { return workers_; }
+
+private:
+  // keeps producer and consumer indices on separate cache lines
+  static constexpr std::size_t cache_line = 64;
+
+  struct entry {
+    std::array<std::byte, max_atr_size> bytes;
+    std::uint8_t size;
+    std::uint64_t sequence;
+  };
+
+  struct ring {
+    std::unique_ptr<entry[]> entries;
+    std::size_t mask;
+    alignas(cache_line) std::atomic<std::size_t> head{0}; // consumer
+    std::atomic_flag claimed = ATOMIC_FLAG_INIT; // by a consuming worker
+    alignas(cache_line) std::atomic<std::size_t> tail{0}; // producer
+    std::uint64_t submitted = 0;
+  };
+
+  // bounded multi producer queue, D. Vyukov
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    completion value;
+  };
+
+  void work(std::size_t worker);
+  bool drain(std::size_t group);
+  void complete(completion &&c);
+  bool pending() const noexcept;
+
+  std::size_t readers_;
+  std::size_t workers_;
+  profile profile_;
+  std::unique_ptr<ring[]> rings_;
+  std::unique_ptr<cell[]> cells_;
+  std::size_t cell_mask_;
+  alignas(cache_line) std::atomic<std::size_t> enqueue_{0};
+  alignas(cache_line) std::atomic<std::size_t> dequeue_{0};
+  std::atomic<bool> stop_{false};
+
+  // sleeping workers, C++17 has no atomic wait
+  std::mutex park_mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable space_available_;
+  std::atomic<std::size_t> parked_{0};  // waiting for work_available_
+  std::atomic<std::size_t> blocked_{0}; // waiting for space_available_
+  std::vector<std::thread> threads_;
+};
+
+} // namespace atr
+
+#endif
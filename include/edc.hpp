@@ -0,0 +1,55 @@
+#ifndef atr_edc_header_
+#define atr_edc_header_
+
+#include "atr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <gsl/span>
+
+namespace atr {
+
+// Error detection codes of the T=1 epilogue field (ISO7816-3:2006, 11.4.4).
+// All of them can be updated incrementally with consecutive parts of a block.
+
+// longitudinal redundancy check, XOR of all bytes
+class lrc {
+  std::byte value_{0};
+
+public:
+  lrc &update(gsl::span<const std::byte> data) noexcept;
+  std::byte value() const noexcept { return value_; }
+};
+
+// CRC according to ISO/IEC 13239 (polynomial 0x1021 reflected, initial
+// value 0xFFFF), using slicing-by-8 lookup tables
+class crc {
+  std::uint16_t value_ = 0xFFFF;
+
+public:
+  crc &update(gsl::span<const std::byte> data) noexcept;
+  std::uint16_t value() const noexcept { return value_; }
+};
+
+// EDC as indicated by the redundancy code of the ATR, see atr::code()
+class edc {
+  redundancy_code code_;
+  lrc lrc_;
+  crc crc_;
+
+public:
+  static constexpr std::size_t max_size = 2;
+
+  explicit edc(redundancy_code code) noexcept : code_(code) {}
+
+  edc &update(gsl::span<const std::byte> data) noexcept;
+  std::size_t size() const noexcept {
+    return code_ == redundancy_code::LRC ? 1 : 2;
+  }
+  // writes the epilogue field to the start of out, returns the used part
+  gsl::span<std::byte> write(gsl::span<std::byte> out) const noexcept;
+};
+
+} // namespace atr
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef atr_format_header_
+#define atr_format_header_
+
+#include "atr.hpp"
+#include "metrics.hpp"
+
+#include <gsl/span>
+
+namespace atr {
+
+enum class dump_format { text, json };
+
+// Writes a decode of the ATR into out without allocating: TS, T0, all
+// interface bytes with their meaning, offered protocols, Fi/Di/FMax, timings
+// for F=Fi, D=Di at clock frequency freq, clock stop, classes, historical
+// bytes and TCK. Text output has one item per line, JSON output is a single
+// object without whitespace.
+// Returns the used part of out, or an empty span if out is too small.
+gsl::span<char> dump(const atr_view &atr, gsl::span<char> out,
+                     dump_format format = dump_format::text,
+                     int freq = 5'000'000);
+
+// Writes the non-zero counters of a metrics snapshot, histogram buckets are
+// keyed by their upper bound in ns.
+gsl::span<char> dump(const metrics::snapshot &snapshot, gsl::span<char> out,
+                     dump_format format = dump_format::text);
+
+} // namespace atr
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef atr_metrics_header_
+#define atr_metrics_header_
+
+#include "atr.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace atr {
+namespace metrics {
+
+// Counters are only collected if the library is built with
+// ATR_ENABLE_METRICS, otherwise the hooks are empty and compile away.
+#ifdef ATR_ENABLE_METRICS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+// bucket 0 counts 0 ns, bucket i > 0 durations in [2^(i-1), 2^i) ns, the last
+// bucket everything above
+constexpr std::size_t latency_buckets = 40;
+using histogram = std::array<std::uint64_t, latency_buckets>;
+
+struct snapshot {
+  std::uint64_t accepted = 0;
+  std::array<std::uint64_t, rule_count> rejected{}; // by rule
+  std::array<std::uint64_t, 16> protocols{};        // T indicated by accepted
+  std::array<std::uint64_t, 256> TA1{};
+  std::uint64_t TA1_absent = 0;
+  histogram parse_ns{};   // successful construction of atr_view or atr
+  histogram receive_ns{}; // successful receive()/receiver::receive()
+};
+
+// sums up the counters of all threads, all zero if metrics are disabled
+snapshot collect() noexcept;
+void reset() noexcept;
+
+// hooks of the library
+#ifdef ATR_ENABLE_METRICS
+class stopwatch {
+  std::chrono::steady_clock::time_point start_ =
+      std::chrono::steady_clock::now();
+
+public:
+  std::chrono::nanoseconds elapsed() const noexcept {
+    return std::chrono::steady_clock::now() - start_;
+  }
+};
+
+void rejected(rule r) noexcept;
+void accepted(const atr_view &atr, const stopwatch &watch) noexcept;
+void received(const stopwatch &watch) noexcept;
+#else
+class stopwatch {};
+
+inline void rejected(rule) noexcept {}
+inline void accepted(const atr_view &, const stopwatch &) noexcept {}
+inline void received(const stopwatch &) noexcept {}
+#endif
+
+} // namespace metrics
+} // namespace atr
+
+#endif
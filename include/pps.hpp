@@ -0,0 +1,65 @@
+#ifndef atr_pps_header_
+#define atr_pps_header_
+
+#include "atr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <gsl/span>
+#include <optional>
+
+namespace atr {
+namespace pps {
+
+// Protocol and parameters selection (ISO7816-3:2006, 9)
+
+// PPSS, PPS0, PPS1, PPS2, PPS3 & PCK
+constexpr std::size_t max_size = 6;
+
+struct request {
+  int T;
+  std::optional<std::byte> PPS1; // Fi/Di, encoded like TA1
+  std::optional<std::byte> PPS2; // SPU
+  std::optional<std::byte> PPS3; // RFU
+};
+
+// parameters to use after a successful exchange
+struct result {
+  int T;
+  int F;
+  int D;
+};
+
+// whether a PPS exchange for a protocol is possible after the ATR
+enum class availability : std::uint8_t {
+  available,  // negotiable mode and the protocol is offered
+  warm_reset, // specific mode, a warm reset changes to negotiable mode
+  none        // specific mode only, or the protocol is not offered
+};
+
+// ISO7816-3:2006, 6.3.1: no PPS exchange is possible in specific mode. A card
+// capable to change (TA2 b8 = 0) answers a warm reset in negotiable mode,
+// whether T is offered then is only known from that ATR.
+availability available(const atr_view &atr, int T) noexcept;
+
+// proposes a request for protocol T using Fi/Di of the ATR, if available()
+std::optional<request> propose(const atr_view &atr, int T);
+
+// writes the request to the start of out, returns the used part of out, an
+// empty span if out is too small
+gsl::span<std::byte> encode(const request &req, gsl::span<std::byte> out);
+
+// number of bytes of the PPS starting with the given bytes, known once
+// PPSS and PPS0 are available, 0 if the bytes do not start a PPS
+std::size_t expected_size(gsl::span<const std::byte> received);
+
+// checks the response of the card to a request, returns the parameters to
+// use if the exchange was successful (including the card accepting only
+// part of the request)
+std::optional<result> validate(const request &req,
+                               gsl::span<const std::byte> response);
+
+} // namespace pps
+} // namespace atr
+
+#endif
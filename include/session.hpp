@@ -0,0 +1,118 @@
+#ifndef atr_session_header_
+#define atr_session_header_
+
+#include "atr.hpp"
+#include "pps.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <gsl/span>
+#include <vector>
+
+namespace atr {
+
+enum class session_state : std::uint8_t {
+  idle,
+  receiving_atr,
+  negotiating, // protocol_state::PPS
+  established, // protocol_state::T0 or T1
+  failed
+};
+
+// State of a single card from reset over ATR and PPS until a protocol is
+// established. Kept small so that many sessions can be held in a vector.
+class session {
+public:
+  using clock = std::chrono::steady_clock;
+
+  session_state state() const noexcept { return state_; }
+  // PPS while negotiating, the negotiated protocol once established
+  protocol_state protocol() const noexcept { return protocol_; }
+  int F() const noexcept { return F_; }
+  int D() const noexcept { return D_; }
+  // warm_reset if the card is in specific mode, but a warm reset allows to
+  // negotiate the protocol and parameters by PPS
+  pps::availability pps_availability() const noexcept {
+    return pps_availability_;
+  }
+
+  gsl::span<const std::byte> atr_bytes() const noexcept {
+    return gsl::span<const std::byte>(atr_).first(atr_size_);
+  }
+
+private:
+  friend class session_pool;
+
+  std::array<std::byte, max_atr_size> atr_;
+  std::array<std::byte, pps::max_size> pps_;
+  std::uint8_t atr_size_ = 0;
+  std::uint8_t pps_size_ = 0;
+  session_state state_ = session_state::idle;
+  protocol_state protocol_ = protocol_state::PPS;
+  pps::availability pps_availability_ = pps::availability::none;
+  bool timer_queued_ = false;
+  std::uint16_t F_ = 372;
+  std::uint8_t D_ = 1;
+  clock::time_point deadline_;
+  clock::time_point queued_;
+  clock::duration wt_;
+  pps::request request_;
+};
+
+// Non-blocking driver for many card sessions: the caller feeds received
+// bytes and the current time, the pool hands out bytes to send and reports
+// when a session is established or failed.
+//
+// Timing (ISO7816-3:2006, 8.1 & 8.2): TS has to arrive within 40000 clock
+// cycles after reset, further ATR characters within 9600 initial etu, the
+// PPS response within WT as indicated by the ATR.
+class session_pool {
+public:
+  using clock = session::clock;
+  using send_function =
+      std::function<void(std::size_t id, gsl::span<const std::byte>)>;
+  using event_function = std::function<void(std::size_t id, const session &)>;
+
+  session_pool(std::size_t sessions, int freq, send_function send,
+               event_function on_change);
+
+  // the card of session id was reset (cold or warm)
+  void reset(std::size_t id, clock::time_point now);
+  void on_bytes(std::size_t id, gsl::span<const std::byte> bytes,
+                clock::time_point now);
+  // handles all timeouts up to now in one go
+  void advance(clock::time_point now);
+  // time of the next timeout to be handled, or clock::time_point::max()
+  clock::time_point next_deadline() const noexcept;
+
+  const session &operator[](std::size_t id) const { return sessions_[id]; }
+  std::size_t size() const noexcept { return sessions_.size(); }
+
+private:
+  struct timer {
+    clock::time_point deadline;
+    std::size_t id;
+  };
+
+  void on_byte(std::size_t id, session &s, std::byte b, clock::time_point now);
+  void atr_complete(std::size_t id, session &s, clock::time_point now);
+  void pps_complete(std::size_t id, session &s);
+  void establish(std::size_t id, session &s, int T, int F, int D);
+  void fail(std::size_t id, session &s);
+  void arm(std::size_t id, session &s, clock::time_point deadline);
+
+  std::vector<session> sessions_;
+  std::vector<timer> timers_;
+  int freq_;
+  clock::duration initial_wait_;
+  clock::duration atr_character_wait_;
+  send_function send_;
+  event_function on_change_;
+};
+
+} // namespace atr
+
+#endif
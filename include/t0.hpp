@@ -0,0 +1,79 @@
+#ifndef atr_t0_header_
+#define atr_t0_header_
+
+#include "atr.hpp"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <gsl/span>
+#include <stdexcept>
+
+namespace atr {
+namespace t0 {
+
+class protocol_error : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Character protocol T=0 (ISO7816-3:2006, 10) from the side of the interface
+// device. Configured from the ATR (WT, GT).
+//
+// Short APDUs of all four cases are mapped to TPDUs (ISO7816-3:2006, 12.2):
+// 6Cxx reissues the command with P3 = xx, 61xx fetches the remaining
+// response with GET RESPONSE.
+// Data is not copied: command data is sent directly from the APDU, response
+// data is received directly into the response buffer.
+// recv_function has to fill the whole buffer, the timeout given is the
+// maximum time between two characters (WT). Every procedure byte starts a new
+// waiting time, so NULL bytes (60) extend it. The time taken by
+// recv_function is also checked against the clock, which returns the time
+// since an arbitrary fixed point (steady_clock if none is given).
+class transport {
+public:
+  using send_function = std::function<bool(gsl::span<const std::byte>)>;
+  using recv_function =
+      std::function<bool(gsl::span<std::byte>, atr::duration timeout)>;
+  using clock_function = std::function<atr::duration()>;
+
+  transport(const atr_view &atr, int F, int D, int freq, send_function send,
+            recv_function recv, clock_function clock = {});
+
+  // sends a short APDU and stores the response data followed by SW1 SW2 in
+  // response, returns the used part of response
+  gsl::span<std::byte> transceive(gsl::span<const std::byte> apdu,
+                                  gsl::span<std::byte> response);
+
+  atr::duration wt() const noexcept { return wt_; }
+  // minimum delay between the characters sent, to configure the sender
+  atr::duration gt() const noexcept { return gt_; }
+
+private:
+  struct status {
+    std::byte sw1;
+    std::byte sw2;
+    std::size_t received; // data bytes received
+  };
+
+  status exchange(gsl::span<const std::byte> header,
+                  gsl::span<const std::byte> command,
+                  gsl::span<std::byte> response);
+  status exchange_in(gsl::span<const std::byte> header,
+                     gsl::span<std::byte> response);
+  void send(gsl::span<const std::byte> data);
+  void receive(gsl::span<std::byte> buffer);
+
+  send_function send_;
+  recv_function recv_;
+  clock_function clock_;
+  atr::duration wt_;
+  atr::duration gt_;
+
+  // headers not taken from the APDU (case 1, 6Cxx, GET RESPONSE)
+  std::array<std::byte, 5> header_;
+};
+
+} // namespace t0
+} // namespace atr
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef atr_t1_header_
+#define atr_t1_header_
+
+#include "atr.hpp"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <gsl/span>
+#include <optional>
+#include <stdexcept>
+
+namespace atr {
+namespace t1 {
+
+class protocol_error : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Block transmission protocol T=1 (ISO7816-3:2006, 11) from the side of the
+// interface device. Configured from the ATR (IFSC, CWT, BWT, redundancy code).
+//
+// Data is not copied: the information fields of I-blocks are sent directly
+// from the APDU, received ones are written directly into the response
+// buffer. A block is therefore handed to send_function in up to three parts
+// (prologue, information field, epilogue).
+// recv_function has to fill the whole buffer, the timeout given is the
+// maximum time until the first requested character arrives.
+class transport {
+public:
+  using send_function = std::function<bool(gsl::span<const std::byte>)>;
+  using recv_function =
+      std::function<bool(gsl::span<std::byte>, atr::duration timeout)>;
+
+  transport(const atr_view &atr, int F, int D, int freq, send_function send,
+            recv_function recv, std::byte nad = std::byte{0});
+
+  // sends an APDU and stores the response APDU in response, returns the used
+  // part of response
+  gsl::span<std::byte> transceive(gsl::span<const std::byte> apdu,
+                                  gsl::span<std::byte> response);
+  // informs the card about the maximum information field size the
+  // interface device is able to receive
+  void negotiate_ifsd(std::size_t ifsd);
+
+  std::size_t ifsc() const noexcept { return ifsc_; }
+  std::size_t ifsd() const noexcept { return ifsd_; }
+  redundancy_code code() const noexcept { return code_; }
+
+private:
+  struct block {
+    std::byte pcb;
+    gsl::span<std::byte> inf;
+  };
+
+  void send_block(std::byte pcb, gsl::span<const std::byte> inf);
+  void resend_block();
+  std::optional<block> receive_block(gsl::span<std::byte> i_inf);
+  void handle_error(int &errors, std::byte error);
+
+  send_function send_;
+  recv_function recv_;
+  std::byte nad_;
+  redundancy_code code_;
+  std::size_t ifsc_;
+  std::size_t ifsd_ = 32;
+  atr::duration bwt_;
+  atr::duration cwt_;
+  int wtx_ = 1;
+  bool ns_ = false;
+  bool nr_ = false;
+
+  // last block sent, and last I-block sent for retransmission requests
+  std::byte last_pcb_;
+  gsl::span<const std::byte> last_inf_;
+  std::byte last_i_pcb_;
+  gsl::span<const std::byte> last_i_inf_;
+  std::array<std::byte, 1> s_inf_;
+  std::array<std::byte, 1> s_rx_;
+};
+
+} // namespace t1
+} // namespace atr
+
+#endif
@@ -0,0 +1,146 @@
+// Drives many simulated readers through receive() and the ATR parser and
+// reports throughput and latency distribution of the ATR path.
+//
+// usage: atr_load_generator [readers] [resets per reader] [threads]
+//                           [fault rate in %]
+
+#include "atr.hpp"
+#include "virtual_card.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+using clock = std::chrono::steady_clock;
+
+const std::vector<std::vector<std::byte>> atrs = {
+    {std::byte{0x3B}, std::byte{0x00}},
+    {std::byte{0x3B}, std::byte{0x10}, std::byte{0x96}},
+    {std::byte{0x3B}, std::byte{0xE0}, std::byte{0x00}, std::byte{0x00},
+     std::byte{0x81}, std::byte{0x31}, std::byte{0xFE}, std::byte{0x45},
+     std::byte{0xEB}},
+    {std::byte{0x3B}, std::byte{0xFF}, std::byte{0x11}, std::byte{0xBB},
+     std::byte{0x00}, std::byte{0x81}, std::byte{0x71}, std::byte{0xEF},
+     std::byte{0x12}, std::byte{0x00}, std::byte{0x15}, std::byte{0x14},
+     std::byte{0x13}, std::byte{0x12}, std::byte{0x11}, std::byte{0x10},
+     std::byte{0x09}, std::byte{0x08}, std::byte{0x07}, std::byte{0x06},
+     std::byte{0x05}, std::byte{0x04}, std::byte{0x03}, std::byte{0x02},
+     std::byte{0x01}, std::byte{0x58}},
+};
+
+struct result {
+  std::vector<double> latencies; // in ns
+  std::size_t valid = 0;
+  std::size_t rejected = 0;
+  double card_time = 0; // virtual time on the line in s
+};
+
+void run_readers(std::size_t first, std::size_t count, std::size_t resets,
+                 int fault_rate, result &res) {
+  std::mt19937 random(static_cast<std::uint32_t>(first));
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int> fault_kind(1, 3);
+
+  std::vector<atr::sim::virtual_card> cards;
+  for (std::size_t i = first; i < first + count; i++)
+    cards.emplace_back(atrs[i % atrs.size()], 5'000'000,
+                       static_cast<std::uint32_t>(i));
+
+  // per thread pool, ATR allocations do not contend on the global heap
+  std::pmr::unsynchronized_pool_resource pool;
+
+  res.latencies.reserve(count * resets);
+  for (std::size_t n = 0; n < resets; n++) {
+    for (auto &card : cards) {
+      if (percent(random) < fault_rate)
+        card.inject(static_cast<atr::sim::fault>(fault_kind(random)), 3);
+      else
+        card.inject(atr::sim::fault::none);
+
+      const auto start = clock::now();
+      auto bytes = atr::receive(
+          [&card](gsl::span<std::byte> buffer) { return card.read(buffer); },
+          &pool);
+      bool valid = !bytes.empty();
+      if (valid) {
+        try {
+          atr::atr parsed(std::move(bytes));
+        } catch (const atr::invalid_atr &) {
+          valid = false;
+        }
+      }
+      const auto end = clock::now();
+
+      res.latencies.push_back(
+          std::chrono::duration<double, std::nano>(end - start).count());
+      res.card_time += card.now().count();
+      (valid ? res.valid : res.rejected)++;
+    }
+  }
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+  const auto idx = static_cast<std::size_t>(p * (sorted.size() - 1));
+  return sorted[idx];
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t readers = argc > 1 ? std::strtoul(argv[1], nullptr, 0)
+                                       : 4096;
+  const std::size_t resets = argc > 2 ? std::strtoul(argv[2], nullptr, 0)
+                                      : 100;
+  const std::size_t threads =
+      argc > 3 ? std::strtoul(argv[3], nullptr, 0)
+               : std::max(1u, std::thread::hardware_concurrency());
+  const int fault_rate = argc > 4 ? std::atoi(argv[4]) : 5;
+
+  std::vector<result> results(threads);
+  std::vector<std::thread> workers;
+  const auto start = clock::now();
+  for (std::size_t t = 0; t < threads; t++) {
+    const auto first = readers * t / threads;
+    const auto count = readers * (t + 1) / threads - first;
+    workers.emplace_back(run_readers, first, count, resets, fault_rate,
+                         std::ref(results[t]));
+  }
+  for (auto &worker : workers)
+    worker.join();
+  const auto elapsed = std::chrono::duration<double>(clock::now() - start);
+
+  result total;
+  for (auto &res : results) {
+    total.latencies.insert(total.latencies.end(), res.latencies.begin(),
+                           res.latencies.end());
+    total.valid += res.valid;
+    total.rejected += res.rejected;
+    total.card_time += res.card_time;
+  }
+  std::sort(total.latencies.begin(), total.latencies.end());
+
+  const auto atrs_total = total.latencies.size();
+  std::printf("readers %zu, resets %zu, threads %zu, fault rate %d%%\n",
+              readers, resets, threads, fault_rate);
+  if (atrs_total == 0) {
+    std::printf("no ATRs received, nothing to report\n");
+    return 0;
+  }
+  std::printf("ATRs %zu (valid %zu, rejected %zu) in %.3f s: %.0f ATR/s\n",
+              atrs_total, total.valid, total.rejected, elapsed.count(),
+              atrs_total / elapsed.count());
+  std::printf("latency [ns] p50 %.0f, p90 %.0f, p99 %.0f, p99.9 %.0f, max "
+              "%.0f\n",
+              percentile(total.latencies, 0.5),
+              percentile(total.latencies, 0.9),
+              percentile(total.latencies, 0.99),
+              percentile(total.latencies, 0.999), total.latencies.back());
+  std::printf("simulated line time per ATR %.3f ms\n",
+              total.card_time / atrs_total * 1e3);
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include "virtual_card.hpp"
+
+#include <algorithm>
+
+namespace atr {
+namespace sim {
+namespace {
+// ISO7816-3:2006, 8.1 Cold reset: TS arrives between 400 and 40000 clocks
+constexpr double answer_delay_clocks = 10'000.0;
+// character duration (start bit, 8 data bits, parity) plus 2 etu guard
+constexpr double character_etus = 12.0;
+constexpr int Fd = 372;
+constexpr int Dd = 1;
+
+bool tck_present(const std::vector<std::byte> &atr) {
+  gsl::span<const std::byte> buffer(atr);
+  bool present = false;
+  iterate(buffer, [&](if_char c, std::size_t, std::byte b) {
+    if (c == if_char::D && (b & std::byte{0x0f}) != std::byte{0})
+      present = true;
+  });
+  return present;
+}
+} // namespace
+
+virtual_card::virtual_card(gsl::span<const std::byte> atr, int freq,
+                           std::uint32_t seed)
+    : atr_(atr.begin(), atr.end()), freq_(freq), random_(seed) {
+  reset();
+}
+
+void virtual_card::inject(fault f, std::size_t amount) {
+  fault_ = f;
+  amount_ = amount;
+  reset();
+}
+
+void virtual_card::reset() {
+  pending_.clear();
+  now_ = duration{0};
+
+  std::vector<std::byte> bytes;
+  if (fault_ == fault::noise) {
+    std::uniform_int_distribution<int> noise(0, 255);
+    for (std::size_t i = 0; i < amount_; i++)
+      bytes.push_back(static_cast<std::byte>(noise(random_)));
+  }
+  bytes.insert(bytes.end(), atr_.begin(), atr_.end());
+  if (fault_ == fault::bad_tck && !bytes.empty()) {
+    // without TCK, break the last byte instead
+    bytes.back() ^= tck_present(atr_) ? std::byte{0x01} : std::byte{0x80};
+  }
+  if (fault_ == fault::truncation)
+    bytes.resize(std::min(bytes.size(), amount_));
+
+  auto at = duration{answer_delay_clocks / freq_};
+  for (const auto b : bytes) {
+    pending_.push_back({b, at});
+    at += character_etus * etu(Fd, Dd);
+  }
+}
+
+void virtual_card::respond(gsl::span<const std::byte> data, int F, int D,
+                           bool block_protocol) {
+  const atr_view parsed(atr_);
+  const auto guard = block_protocol ? parsed.cgt(F, D, freq_)
+                                    : parsed.gt(F, D, freq_);
+  auto at = (pending_.empty() ? now_ : pending_.back().at) + guard;
+  for (const auto b : data) {
+    pending_.push_back({b, at});
+    at += guard;
+  }
+}
+
+std::optional<virtual_card::character> virtual_card::next() {
+  if (pending_.empty())
+    return {};
+  const auto c = pending_.front();
+  pending_.pop_front();
+  now_ = c.at;
+  return c;
+}
+
+bool virtual_card::read(gsl::span<std::byte> buffer) {
+  if (buffer.size() > pending_.size())
+    return false;
+  for (auto &b : buffer)
+    b = next()->value;
+  return true;
+}
+
+std::size_t virtual_card::read_some(gsl::span<std::byte> buffer) {
+  const auto count = std::min(buffer.size(), pending_.size());
+  for (std::size_t i = 0; i < count; i++)
+    buffer[i] = next()->value;
+  return count;
+}
+
+virtual_card::duration virtual_card::etu(int F, int D) const noexcept {
+  return duration{static_cast<double>(F) / D / freq_};
+}
+
+} // namespace sim
+} // namespace atr
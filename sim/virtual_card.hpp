@@ -0,0 +1,70 @@
+#ifndef atr_virtual_card_header_
+#define atr_virtual_card_header_
+
+#include "atr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <gsl/span>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace atr {
+namespace sim {
+
+enum class fault : std::uint8_t {
+  none,
+  truncation, // card stops sending in the middle of the ATR
+  bad_tck,    // TCK (or last byte if absent) is corrupted
+  noise       // random bytes on the line before TS
+};
+
+// Card that answers a reset with an ATR, emitting characters on a virtual
+// time line. Characters of the ATR are sent in initial etu (F=372, D=1) with
+// the minimum distance of 12 etu, later responses are spaced by the guard
+// time the ATR indicates (GT for T=0 & PPS, CGT for T=1).
+class virtual_card {
+public:
+  using duration = atr::duration;
+
+  struct character {
+    std::byte value;
+    duration at; // time since reset
+  };
+
+  explicit virtual_card(gsl::span<const std::byte> atr,
+                        int freq = 5'000'000, std::uint32_t seed = 0);
+
+  void inject(fault f, std::size_t amount = 1);
+  // restarts emission of the ATR, resets the virtual time
+  void reset();
+  // queues a response, F & D are the transmission parameters in use
+  void respond(gsl::span<const std::byte> data, int F, int D,
+               bool block_protocol = false);
+
+  std::optional<character> next();
+  duration now() const noexcept { return now_; }
+  const std::vector<std::byte> &atr_bytes() const noexcept { return atr_; }
+
+  // reader functions for receive() and receiver
+  bool read(gsl::span<std::byte> buffer);
+  std::size_t read_some(gsl::span<std::byte> buffer);
+
+private:
+  duration etu(int F, int D) const noexcept;
+
+  std::vector<std::byte> atr_;
+  int freq_;
+  fault fault_ = fault::none;
+  std::size_t amount_ = 0;
+  std::mt19937 random_;
+  std::deque<character> pending_;
+  duration now_{0};
+};
+
+} // namespace sim
+} // namespace atr
+
+#endif
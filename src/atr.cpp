@@ -1,220 +1,429 @@
 #include "atr.hpp"
 
-#include <map>
-#include <numeric>
+#include <algorithm>
 #include <string>
 
+#include "metrics.hpp"
 #include "utility.hpp"
 
 namespace atr {
 namespace {
-int Fi_lookup[] = {372, 372, 558, 744,  1116, 1488, 1860, 0,
-                   0,   512, 768, 1024, 1536, 2048, 0,    0};
-int FMax_lookup[] = {4'000'000,  5'000'000,  6'000'000,  8'000'000,
-                     12'000'000, 16'000'000, 20'000'000, 0,
-                     0,          5'000'000,  7'500'000,  10'000'000,
-                     15'000'000, 20'000'000, 0,          0};
-int Di_lookup[] = {0, 1, 2, 4, 8, 16, 32, 64, 12, 20, 0, 0, 0, 0, 0, 0};
-} // namespace
-
-atr::atr(std::vector<std::byte> bytes) : bytes_(std::move(bytes)) {
-  gsl::span<const std::byte> buffer(bytes_);
-  bool tck_present = false;
-  bool valid = iterate(
-      buffer,
-      [&](if_char c, std::size_t i, std::byte b) {
-        if (c == if_char::D && (b & 0x0f_b) != 0_b)
-          tck_present = true;
-
-        switch (i) {
-        case 0:
-          switch (c) {
-          case if_char::A: // TA1
-            if (Fi() == 0)
-              throw invalid_atr("invalid Fi");
-            if (Di() == 0)
-              throw invalid_atr("invalid Di");
-            break;
-          case if_char::B: // TB1 -> deprecated, ignore
-          case if_char::C: // TC1 -> all valid
-          case if_char::D: // TD1
-            break;
-          }
-          break;
-        case 1:
-          switch (c) {
-          case if_char::A: // TA2
-            if ((b & 0x60_b) != 0x0_b)
-              throw invalid_atr("TA2 RFU bits set");
-            break;
-          case if_char::B: // TB2
-            break;
-          case if_char::C: // TC2
-            if (b == 0_b)
-              throw invalid_atr("invalid TC2/WI");
-            break;
-          case if_char::D:
-            break;
-          }
-        default:
-          break;
-        }
-      },
-      [&](std::byte T, if_char c, std::size_t n, std::byte b) {
-        if (n > 0)
-          return;
-        switch (T) {
-        case 1_b:
-          switch (c) {
-          case if_char::A: // TA T=1
-            if (b == 0_b || b == 0xff_b)
-              throw invalid_atr("invalid TA for T=1 (IFSC)");
-            break;
-          case if_char::B: // TB T=1
-            if ((b & 0xf0_b) > 0x90_b)
-              throw invalid_atr("invalid TB for T=1, BWI too big");
-            break;
-          case if_char::C: // TC T=1
-            if ((b & 0xFE_b) != 0_b)
-              throw invalid_atr("invalid TC for T=1");
-            break;
-          case if_char::D:
-            break;
-          }
-          break;
-        case 15_b:
-          switch (c) {
-          case if_char::A:
-            if ((b & 0b00111000_b) != 0_b || (b & 0x7_b) == 0_b)
-              throw invalid_atr("invalid classes of operating conditions");
-          case if_char::B:
-            break;
-          default:
-            break;
-          }
-        default:
-          break;
-        }
-      });
-
-  if (!valid)
-    throw invalid_atr("structural bytes seem invalid");
-
-  auto K = static_cast<std::size_t>(bytes_[1] & 0x0f_b);
-  if (buffer.size() < K)
-    throw invalid_atr("not enough bytes for stated historical byte length");
-  historical_bytes_ =
-      std::vector<std::byte>(buffer.begin(), buffer.begin() + K);
-  buffer = buffer.subspan(K);
+constexpr const char *rule_message[] = {
+    "",
+    "structural bytes seem invalid",
+    "too many interface bytes",
+    "not enough bytes for stated historical byte length",
+    "necessary TCK absent",
+    "invalid TCK",
+    "too many bytes in ATR",
+    "invalid Fi",
+    "invalid Di",
+    "TA2 RFU bits set",
+    "invalid TC2/WI",
+    "invalid TA for T=1 (IFSC)",
+    "invalid TB for T=1, BWI too big",
+    "invalid TC for T=1",
+    "invalid classes of operating conditions",
+    "EMV: invalid TS",
+    "EMV: unsupported TA1",
+    "EMV: TB1 must be 00",
+    "EMV: TB1 absent",
+    "EMV: invalid T in TD1",
+    "EMV: TA2 specific mode differs from TD1",
+    "EMV: TA2 implicit divider set",
+    "EMV: TB2 present",
+    "EMV: TC2 must be 0A",
+    "EMV: invalid T in TD2",
+    "EMV: TD2 must indicate T=1",
+    "EMV: IFSC too small",
+    "EMV: BWI too big",
+    "EMV: CWI too big",
+    "EMV: CWT not bigger than CGT",
+    "EMV: TB for T=1 absent",
+    "EMV: only LRC supported for T=1",
+};
+static_assert(std::size(rule_message) == rule_count);
 
-  if (tck_present) {
-    if (buffer.size() < 1)
-      throw invalid_atr("necessary TCK absent");
-    auto check =
-        std::accumulate(bytes_.cbegin() + 1, bytes_.cend(), 0_b,
-                        [](std::byte a, std::byte b) { return a ^ b; });
-    if (check != 0_b)
-      throw invalid_atr(std::string("invalid TCK ") +
-                        std::to_string(static_cast<int>(check)));
-    buffer = buffer.subspan(1);
+class category : public std::error_category {
+public:
+  const char *name() const noexcept override { return "atr"; }
+  std::string message(int value) const override {
+    return ::atr::message(static_cast<rule>(value));
   }
+};
 
-  if (buffer.size())
-    throw invalid_atr("too many bytes in ATR");
+constexpr std::byte default_TA1 = 0x11_b;
+
+// per byte value lookup of the rule violated by an interface byte
+using check_table = std::array<rule, 256>;
+
+template <class F> constexpr check_table make_check(F violation) {
+  check_table table{};
+  for (std::size_t i = 0; i < table.size(); i++)
+    table[i] = violation(static_cast<std::byte>(i));
+  return table;
 }
 
-std::optional<std::byte> atr::intf_char(if_char c, int idx) const noexcept {
-  if (idx <= 0)
-    return {};
+enum check : std::uint8_t {
+  no_check,
+  iso_TA1,
+  iso_TA2,
+  iso_TC2,
+  iso_TA_T1,
+  iso_TB_T1,
+  iso_TC_T1,
+  iso_TA_T15,
+  emv_TA1,
+  emv_TB1,
+  emv_TD1,
+  emv_TA2,
+  emv_TB2,
+  emv_TC2,
+  emv_TD2,
+  emv_TA_T1,
+  emv_TB_T1,
+  emv_TC_T1,
+  check_count
+};
 
-  std::size_t tdx_offset = 1;
-  while (--idx) {
-    std::byte tdx = bytes_[tdx_offset];
-    if ((tdx & static_cast<std::byte>(if_char::D)) == 0_b)
-      return {};
-    tdx_offset += offset(tdx, if_char::D);
+constexpr std::array<check_table, check_count> checks = {
+    make_check([](std::byte) { return rule::none; }),
+    // ISO7816-3:2006, 8.3 Global interface bytes
+    make_check([](std::byte b) {
+      if (Fi_lookup[std::to_integer<std::size_t>(b >> 4)] == 0)
+        return rule::invalid_Fi;
+      if (Di_lookup[std::to_integer<std::size_t>(b & 0x0f_b)] == 0)
+        return rule::invalid_Di;
+      return rule::none;
+    }),
+    make_check([](std::byte b) {
+      return (b & 0x60_b) != 0_b ? rule::TA2_rfu : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return b == 0_b ? rule::invalid_WI : rule::none;
+    }),
+    // ISO7816-3:2006, 11.4 Specific interface bytes for T=1
+    make_check([](std::byte b) {
+      return (b == 0_b || b == 0xff_b) ? rule::invalid_ifsc : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return (b & 0xf0_b) > 0x90_b ? rule::invalid_bwi : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return (b & 0xFE_b) != 0_b ? rule::invalid_T1_TC : rule::none;
+    }),
+    // ISO7816-3:2006, 8.3 Global interface bytes, first TA for T=15
+    make_check([](std::byte b) {
+      return ((b & 0b00111000_b) != 0_b || (b & 0x7_b) == 0_b)
+                 ? rule::invalid_classes
+                 : rule::none;
+    }),
+    // EMV Book 1 v4.3, 8.3 Characters Returned by ICC at Reset
+    make_check([](std::byte b) {
+      return (b < 0x11_b || b > 0x13_b) ? rule::emv_TA1 : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return b != 0_b ? rule::emv_TB1 : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return (b & 0x0e_b) != 0_b ? rule::emv_TD1 : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return (b & 0x10_b) != 0_b ? rule::emv_TA2_divider : rule::none;
+    }),
+    make_check([](std::byte) { return rule::emv_TB2; }),
+    make_check([](std::byte b) {
+      return b != 0x0A_b ? rule::emv_TC2 : rule::none;
+    }),
+    make_check([](std::byte b) {
+      const auto T = b & 0x0f_b;
+      return (T != 1_b && T != 0x0E_b) ? rule::emv_TD2 : rule::none;
+    }),
+    make_check([](std::byte b) {
+      return b < 0x10_b ? rule::emv_ifsc : rule::none;
+    }),
+    make_check([](std::byte b) {
+      if ((b >> 4) > 4_b)
+        return rule::emv_bwi;
+      if ((b & 0x0f_b) > 5_b)
+        return rule::emv_cwi;
+      return rule::none;
+    }),
+    make_check([](std::byte b) {
+      return b != 0_b ? rule::emv_lrc : rule::none;
+    }),
+};
 
-    if (tdx_offset > bytes_.size())
-      return {};
-  }
+struct position_checks {
+  check iso;
+  check emv;
+};
+
+// checks for TAi..TDi of the first two interface blocks
+constexpr position_checks global_checks[2][4] = {
+    {{iso_TA1, emv_TA1}, {no_check, emv_TB1}, {}, {no_check, emv_TD1}},
+    {{iso_TA2, emv_TA2}, {no_check, emv_TB2}, {iso_TC2, emv_TC2},
+     {no_check, emv_TD2}},
+};
+
+// checks for the first TA, TB, TC for each T (following the second block)
+constexpr auto specific_checks = []() {
+  std::array<std::array<position_checks, 3>, 16> table{};
+  table[1] = {{{iso_TA_T1, emv_TA_T1},
+               {iso_TB_T1, emv_TB_T1},
+               {iso_TC_T1, emv_TC_T1}}};
+  table[15][0] = {iso_TA_T15, no_check};
+  return table;
+}();
+
+constexpr std::byte char_mask[] = {0x10_b, 0x20_b, 0x40_b};
+} // namespace
+
+const char *message(rule r) noexcept {
+  return rule_message[static_cast<std::size_t>(r)];
+}
+
+const std::error_category &atr_category() noexcept {
+  static const category instance;
+  return instance;
+}
 
-  if ((bytes_[tdx_offset] & static_cast<std::byte>(c)) == 0_b)
+std::error_code make_error_code(rule r) noexcept {
+  return {static_cast<int>(r), atr_category()};
+}
+
+#ifndef ATR_FREESTANDING
+atr_view::atr_view(gsl::span<const std::byte> bytes, profile p)
+    : bytes_(bytes) {
+  if (const auto r = validate(p); r != rule::none)
+    throw invalid_atr(r, message(r));
+}
+#endif
+
+std::optional<atr_view> atr_view::parse(gsl::span<const std::byte> bytes,
+                                        std::error_code &ec,
+                                        profile p) noexcept {
+  atr_view view;
+  view.bytes_ = bytes;
+  const auto r = view.validate(p);
+  ec = r;
+  if (r != rule::none)
     return {};
+  return view;
+}
 
-  std::size_t txx_offset = tdx_offset + offset(bytes_[tdx_offset], c);
-  if (txx_offset > bytes_.size())
+std::optional<atr_view> atr_view::decode(gsl::span<const std::byte> bytes,
+                                         profile p) noexcept {
+  atr_view view;
+  view.bytes_ = bytes;
+  if (view.apply_rules(p) != rule::none)
     return {};
-  return bytes_[txx_offset];
+  return view;
+}
+
+rule atr_view::validate(profile p) noexcept {
+  const metrics::stopwatch watch;
+  const auto r = apply_rules(p);
+  if (r != rule::none)
+    metrics::rejected(r);
+  else
+    metrics::accepted(*this, watch);
+  return r;
 }
 
-std::optional<std::byte> atr::first(if_char c, int T) const noexcept {
-  std::size_t tdx_offset = 1;
-  int block = 1;
+rule atr_view::apply_rules(profile p) noexcept {
+  // EMV violations only invalidate the ATR if the EMV profile was requested.
+  // They do not affect the structure, so parsing continues and the first
+  // violation found is reported by reject().
+  rule emv_violation = rule::none;
+  auto reject = [&](rule r) {
+    if (emv_violation != rule::none)
+      r = emv_violation;
+    return r;
+  };
+  auto emv_require = [&](bool condition, rule violation) {
+    if (condition)
+      return;
+    if (p == profile::EMV && emv_violation == rule::none)
+      emv_violation = violation;
+    emv_compliant_ = false;
+  };
+  // returns the ISO violation of an interface byte, EMV ones are recorded
+  auto check = [&](position_checks pos, std::byte b) {
+    const auto idx = std::to_integer<std::size_t>(b);
+    const auto iso = checks[pos.iso][idx];
+    if (iso == rule::none) {
+      const auto emv = checks[pos.emv][idx];
+      emv_require(emv == rule::none, emv);
+    }
+    return iso;
+  };
+
+  const auto size = bytes_.size();
+  if (size < 2)
+    return reject(rule::structure);
+
+  // see EMV Book 1 v4.3, 8.3 Characters Returned by ICC at Reset
+  emv_require(bytes_[0] == 0x3B_b || bytes_[0] == 0x3F_b, rule::emv_TS);
+
+  // single pass over the interface bytes: record block offsets, validate
+  // every byte and build the TCK check value
+  std::byte check_value = bytes_[1];
+  std::byte TA1 = default_TA1;
+  std::byte T = 0_b;
+  std::byte TD1_T = 0_b;
+  int N = 0;
+  bool tck_present = false;
+  bool T1_offered = false;
+  bool tb1_present = false;
+  bool tb_T1_present = false;
+  std::uint16_t specific_seen[3] = {};
+  std::size_t pos = 1;
   while (true) {
-    std::byte tdx = bytes_[tdx_offset];
-    if (block > 2 && (static_cast<int>(tdx & 0x0f_b) == T) &&
-        ((tdx & static_cast<std::byte>(c)) != 0_b)) {
-      std::size_t txx_offset = tdx_offset + offset(tdx, c);
-      if (txx_offset > bytes_.size())
-        return {}; // TODO not really needed?
-      return bytes_[txx_offset];
+    if (blocks_ == td_offsets_.size())
+      return reject(rule::too_many_interface_bytes);
+    const std::size_t block = blocks_++;
+    td_offsets_[block] = static_cast<std::uint8_t>(pos);
+
+    const std::byte Y = bytes_[pos++];
+    for (std::size_t c = 0; c < 3; c++) {
+      if ((Y & char_mask[c]) == 0_b)
+        continue;
+      if (pos >= size)
+        return reject(rule::structure);
+      const std::byte b = bytes_[pos++];
+      check_value ^= b;
+
+      bool first_for_T = false;
+      rule iso_violation = rule::none;
+      if (block < 2) {
+        iso_violation = check(global_checks[block][c], b);
+      } else {
+        const auto T_bit = static_cast<std::uint16_t>(
+            1u << std::to_integer<unsigned>(T));
+        first_for_T = (specific_seen[c] & T_bit) == 0;
+        specific_seen[c] |= T_bit;
+        if (first_for_T)
+          iso_violation =
+              check(specific_checks[std::to_integer<std::size_t>(T)][c], b);
+      }
+      if (iso_violation != rule::none)
+        return reject(iso_violation);
+
+      if (block == 0 && c == 0)
+        TA1 = b;
+      else if (block == 0 && c == 1)
+        tb1_present = true;
+      else if (block == 0 && c == 2)
+        N = (b != 255_b) ? std::to_integer<int>(b) : -1;
+      else if (block == 1 && c == 0)
+        emv_require((b & 0x0f_b) == TD1_T, rule::emv_TA2_mode);
+      else if (first_for_T && T == 1_b && c == 1) {
+        tb_T1_present = true;
+        const auto CWI = std::to_integer<int>(b & 0x0f_b);
+        emv_require((1 << CWI) > N + 1, rule::emv_cwt);
+      }
     }
 
-    if ((tdx & static_cast<std::byte>(if_char::D)) == 0_b)
-      return {};
-    tdx_offset += offset(tdx, if_char::D);
-    block++;
+    if ((Y & 0x80_b) == 0_b)
+      break;
 
-    if (tdx_offset > bytes_.size())
-      return {};
-  };
-}
+    if (pos >= size)
+      return reject(rule::structure);
+    const std::byte TD = bytes_[pos];
+    check_value ^= TD;
+    if (block < 2) {
+      if (const auto r = check(global_checks[block][3], TD); r != rule::none)
+        return reject(r);
+    }
+    T = TD & 0x0f_b;
+    if (T != 0_b)
+      tck_present = true;
+    if (T == 1_b)
+      T1_offered = true;
+    if (block == 0)
+      TD1_T = T;
+    else if (block == 1)
+      emv_require(TD1_T != 1_b || T == 1_b, rule::emv_TD2_T1);
+  }
 
-bool atr::T_present(int i) const noexcept {
-  if (i < 0)
-    return false;
+  emv_require(tb1_present, rule::emv_TB1_absent);
+  emv_require(!T1_offered || tb_T1_present, rule::emv_TB_T1_absent);
 
-  std::size_t tdx_offset = 1;
-  while (true) {
-    std::byte tdx = bytes_[tdx_offset];
-    if ((tdx & 0x0f_b) == std::byte(i))
-      return true;
-    if ((tdx & static_cast<std::byte>(if_char::D)) == 0_b)
-      return false;
-    tdx_offset += offset(tdx, if_char::D);
+  Fi_ = Fi_lookup[std::to_integer<std::size_t>(TA1 >> 4)];
+  FMax_ = FMax_lookup[std::to_integer<std::size_t>(TA1 >> 4)];
+  Di_ = Di_lookup[std::to_integer<std::size_t>(TA1 & 0x0f_b)];
+
+  const auto K = std::to_integer<std::size_t>(bytes_[1] & 0x0f_b);
+  if (size - pos < K)
+    return reject(rule::historical_bytes_missing);
+  historical_offset_ = static_cast<std::uint8_t>(pos);
+  historical_size_ = static_cast<std::uint8_t>(K);
+  for (const auto b : historical_bytes())
+    check_value ^= b;
+  pos += K;
 
-    if (tdx_offset > bytes_.size())
-      return false;
+  if (tck_present) {
+    if (pos >= size)
+      return reject(rule::tck_absent);
+    check_value ^= bytes_[pos++];
+    if (check_value != 0_b)
+      return reject(rule::invalid_tck);
   }
-}
 
-const std::vector<std::byte> &atr::historical_bytes() const noexcept {
-  return historical_bytes_;
+  if (pos != size)
+    return reject(rule::too_many_bytes);
+  if (emv_violation != rule::none)
+    return reject(emv_violation);
+  return rule::none;
 }
 
-constexpr std::byte default_TA1 = 0x11_b;
+std::optional<std::byte> atr_view::intf_char(if_char c,
+                                             int idx) const noexcept {
+  if (idx <= 0 || static_cast<std::size_t>(idx) > blocks_)
+    return {};
 
-int atr::Fi() const noexcept {
-  auto TA1 = intf_char(if_char::A, 1).value_or(default_TA1);
-  return Fi_lookup[std::to_integer<std::size_t>(TA1 >> 4)];
+  const std::size_t tdx_offset = td_offsets_[idx - 1];
+  const std::byte tdx = bytes_[tdx_offset];
+  if ((tdx & static_cast<std::byte>(c)) == 0_b)
+    return {};
+  return bytes_[tdx_offset + offset(tdx, c)];
 }
 
-int atr::FMax() const noexcept {
-  auto TA1 = intf_char(if_char::A, 1).value_or(default_TA1);
-  return FMax_lookup[std::to_integer<std::size_t>(TA1 >> 4)];
+std::optional<std::byte> atr_view::first(if_char c, int T) const noexcept {
+  for (std::size_t block = 2; block < blocks_; block++) {
+    const std::size_t tdx_offset = td_offsets_[block];
+    const std::byte tdx = bytes_[tdx_offset];
+    if ((static_cast<int>(tdx & 0x0f_b) == T) &&
+        ((tdx & static_cast<std::byte>(c)) != 0_b))
+      return bytes_[tdx_offset + offset(tdx, c)];
+  }
+  return {};
 }
 
-int atr::Di() const noexcept {
-  auto TA1 = intf_char(if_char::A, 1).value_or(default_TA1);
-  return Di_lookup[std::to_integer<std::size_t>(TA1 & 0x0f_b)];
+bool atr_view::T_present(int i) const noexcept {
+  if (i < 0)
+    return false;
+
+  for (std::size_t block = 0; block < blocks_; block++) {
+    if ((bytes_[td_offsets_[block]] & 0x0f_b) == std::byte(i))
+      return true;
+  }
+  return false;
 }
 
-uint8_t atr::N() const noexcept {
+int atr_view::Fi() const noexcept { return Fi_; }
+
+int atr_view::FMax() const noexcept { return FMax_; }
+
+int atr_view::Di() const noexcept { return Di_; }
+
+uint8_t atr_view::N() const noexcept {
   const auto TC1 = intf_char(if_char::C, 1).value_or(0x00_b);
   return (TC1 != 255_b) ? std::to_integer<int>(TC1) : 0;
 }
 
-atr::duration atr::gt(int F, int D, int freq) const noexcept {
+atr_view::duration atr_view::gt(int F, int D, int freq) const noexcept {
   // see ISO7816-3:2006, 8.3 Global interface bytes, TC1, p. 19
   // since the calcuation (possibly) mixes ETUs and "indicated ETUs", return
   // result as time
@@ -227,78 +436,116 @@ atr::duration atr::gt(int F, int D, int freq) const noexcept {
   return duration(12 * actual_etu + N * base_etu);
 }
 
-bool atr::specific_mode() const noexcept {
+bool atr_view::specific_mode() const noexcept {
   const auto TA2 = intf_char(if_char::A, 2);
   return bool(TA2);
 }
 
-int atr::specific_mode_T() const noexcept {
+int atr_view::specific_mode_T() const noexcept {
   const auto TA2 = intf_char(if_char::A, 2).value_or(0x00_b);
   return static_cast<int>(TA2 & 0x0f_b);
 }
 
-bool atr::specific_change_capable() const noexcept {
-  const auto TA2 = intf_char(if_char::A, 2).value_or(0x00_b);
-  return (TA2 & 0x80_b) != 0_b;
+// ISO7816-3:2006, 8.3: b8 = 0 indicates the capability to change between
+// negotiable and specific mode (by a warm reset)
+bool atr_view::specific_change_capable() const noexcept {
+  const auto TA2 = intf_char(if_char::A, 2);
+  return TA2 && (*TA2 & 0x80_b) == 0_b;
 }
 
-bool atr::implicit_divider() const noexcept {
+bool atr_view::implicit_divider() const noexcept {
   const auto TA2 = intf_char(if_char::A, 2).value_or(0x00_b);
   return (TA2 & 0x10_b) != 0_b;
 }
 
-clockstop_indicator atr::clockstop() const noexcept {
+clockstop_indicator atr_view::clockstop() const noexcept {
   auto TA = first(if_char::A, 15).value_or(0x01_b);
   return static_cast<clockstop_indicator>(TA >> 6);
 }
 
-operating_condition atr::classes() const noexcept {
+operating_condition atr_view::classes() const noexcept {
   auto TA = first(if_char::A, 15).value_or(0x01_b);
   return static_cast<operating_condition>(TA & 0x07_b);
 }
 
-atr::duration atr::wt(int freq) const noexcept {
+atr_view::duration atr_view::wt(int freq) const noexcept {
   const auto TC2 = intf_char(if_char::C, 2).value_or(10_b);
   const auto WI = static_cast<double>(TC2);
   const auto Fi = static_cast<double>(this->Fi());
   return duration(WI * 960.0 * Fi / freq);
 }
 
-std::size_t atr::ifsc() const noexcept {
+std::size_t atr_view::ifsc() const noexcept {
   // ISO7816-3:2006, 11.4.2 Information field sizes, p. 27
   return static_cast<std::size_t>(first(if_char::A, 1).value_or(32_b));
 }
 
-atr::duration atr::cgt(int F, int D, int freq) const noexcept {
+atr_view::duration atr_view::cgt(int F, int D, int freq) const noexcept {
   // ISO7816-3:2006, 11.2 Character frame, p. 24
   const auto N = intf_char(if_char::C, 1).value_or(0x00_b);
   return (N != 255_b) ? gt(F, D, freq) : duration{11.0 * etu(F, D, freq)};
 }
 
-atr::duration atr::bgt(int F, int D, int freq) const noexcept {
+atr_view::duration atr_view::bgt(int F, int D, int freq) const noexcept {
   return duration{22.0 * etu(F, D, freq)};
 }
 
-atr::duration atr::cwt(int F, int D, int freq) const noexcept {
+atr_view::duration atr_view::cwt(int F, int D, int freq) const noexcept {
   auto TB = first(if_char::B, 1).value_or(0x4D_b);
   const auto CWI = static_cast<int>(TB & 0x0f_b);
   const auto etus = 11.0 + static_cast<double>(1 << CWI);
   return duration{etus * etu(F, D, freq)};
 }
 
-atr::duration atr::bwt(int F, int D, int freq) const noexcept {
+atr_view::duration atr_view::bwt(int F, int D, int freq) const noexcept {
   auto TB = first(if_char::B, 1).value_or(0x4D_b);
   const auto BWI = static_cast<int>((TB >> 4) & 0x0f_b);
   const auto additional = static_cast<double>(1 << BWI) * 960.0 * 372 / freq;
   return duration{11.0 * etu(F, D, freq) + additional};
 }
 
-redundancy_code atr::code() const noexcept {
+redundancy_code atr_view::code() const noexcept {
   auto TC = first(if_char::C, 1).value_or(0x00_b);
   return (TC & 0x01_b) == 0_b ? redundancy_code::LRC : redundancy_code::CRC;
 }
 
-constexpr std::size_t atr::offset(std::byte tdx, if_char c) const noexcept {
+void atr_view::sweep(gsl::span<const int> F, gsl::span<const int> D,
+                     gsl::span<const int> freq,
+                     const timings &out) const noexcept {
+  // every timing is (a * F / D + b) / freq with a and b given by the ATR
+  auto evaluate = [&](double a, double b, gsl::span<duration> result) {
+    if (result.empty())
+      return;
+    const std::size_t n =
+        std::min({F.size(), D.size(), freq.size(), result.size()});
+    const int *f = F.data();
+    const int *d = D.data();
+    const int *fr = freq.data();
+    duration *r = result.data();
+    for (std::size_t i = 0; i < n; i++)
+      r[i] = duration((a * f[i] / d[i] + b) / fr[i]);
+  };
+
+  // see gt(): N extra ETUs, indicated ETUs if T=15 is present
+  const double N = this->N();
+  const double indicated = static_cast<double>(Fi()) / Di();
+  if (T_present(15))
+    evaluate(12.0, N * indicated, out.gt);
+  else
+    evaluate(12.0 + N, 0.0, out.gt);
+
+  const auto WI = static_cast<double>(intf_char(if_char::C, 2).value_or(10_b));
+  evaluate(0.0, WI * 960.0 * Fi(), out.wt);
+
+  const auto TB = first(if_char::B, 1).value_or(0x4D_b);
+  const auto CWI = std::to_integer<int>(TB & 0x0f_b);
+  const auto BWI = std::to_integer<int>(TB >> 4);
+  evaluate(11.0 + (1 << CWI), 0.0, out.cwt);
+  evaluate(11.0, static_cast<double>(1 << BWI) * 960.0 * 372, out.bwt);
+}
+
+constexpr std::size_t atr_view::offset(std::byte tdx,
+                                       if_char c) const noexcept {
   std::byte offset_mask = [c]() {
     switch (c) {
     case if_char::A:
@@ -315,10 +562,83 @@ constexpr std::size_t atr::offset(std::byte tdx, if_char c) const noexcept {
   return popcount(tdx & offset_mask) + 1;
 };
 
-constexpr double atr::etu(int F, int D, int freq) const noexcept {
+constexpr double atr_view::etu(int F, int D, int freq) const noexcept {
   return static_cast<double>(F) / D / freq;
 }
 
+#ifndef ATR_FREESTANDING
+atr::atr(gsl::span<const std::byte> bytes, profile p,
+         const allocator_type &alloc)
+    : atr(std::pmr::vector<std::byte>(bytes.begin(), bytes.end(), alloc), p) {}
+
+atr::atr(std::allocator_arg_t, const allocator_type &alloc,
+         gsl::span<const std::byte> bytes, profile p)
+    : atr(bytes, p, alloc) {}
+
+atr::atr(std::pmr::vector<std::byte> bytes, profile p)
+    : bytes_(std::move(bytes)), historical_bytes_(bytes_.get_allocator()) {
+  atr_view::operator=(atr_view(bytes_, p));
+  const auto historical = atr_view::historical_bytes();
+  historical_bytes_.assign(historical.begin(), historical.end());
+}
+
+atr::atr(const atr_view &view, const allocator_type &alloc)
+    : atr_view(view), bytes_(view.bytes().begin(), view.bytes().end(), alloc),
+      historical_bytes_(view.historical_bytes().begin(),
+                        view.historical_bytes().end(), alloc) {
+  rebind(bytes_);
+}
+
+atr::atr(const atr &other)
+    : atr_view(other), bytes_(other.bytes_),
+      historical_bytes_(other.historical_bytes_) {
+  rebind(bytes_);
+}
+
+atr::atr(atr &&other) noexcept
+    : atr_view(other), bytes_(std::move(other.bytes_)),
+      historical_bytes_(std::move(other.historical_bytes_)) {
+  rebind(bytes_);
+  other.reset();
+}
+
+atr::atr(const atr &other, const allocator_type &alloc)
+    : atr_view(other), bytes_(other.bytes_, alloc),
+      historical_bytes_(other.historical_bytes_, alloc) {
+  rebind(bytes_);
+}
+
+atr::atr(atr &&other, const allocator_type &alloc)
+    : atr_view(other), bytes_(std::move(other.bytes_), alloc),
+      historical_bytes_(std::move(other.historical_bytes_), alloc) {
+  rebind(bytes_);
+  other.reset();
+}
+
+atr &atr::operator=(const atr &other) {
+  atr_view::operator=(other);
+  bytes_ = other.bytes_;
+  historical_bytes_ = other.historical_bytes_;
+  rebind(bytes_);
+  return *this;
+}
+
+atr &atr::operator=(atr &&other) {
+  atr_view::operator=(other);
+  bytes_ = std::move(other.bytes_);
+  historical_bytes_ = std::move(other.historical_bytes_);
+  rebind(bytes_);
+  other.reset();
+  return *this;
+}
+
+void atr::reset() noexcept {
+  bytes_.clear();
+  historical_bytes_.clear();
+  clear();
+  rebind(bytes_);
+}
+
 bool iterate(gsl::span<const std::byte> &atr,
              std::function<void(if_char, std::size_t, std::byte)> func) {
   if (atr.size() < 2)
@@ -348,7 +668,8 @@ bool iterate(
     std::function<void(if_char, std::size_t, std::byte)> global,
     std::function<void(std::byte T, if_char c, std::size_t n, std::byte b)>
         specific) {
-  std::map<std::byte, std::size_t> cnts;
+  // occurrences of each specific interface byte, indexed by c|T
+  std::array<std::size_t, 256> cnts{};
   std::byte T = 0_b;
   return iterate(atr, [&](auto c, auto i, auto b) {
     if (c == if_char::D)
@@ -357,10 +678,11 @@ bool iterate(
       global(c, i, b);
     } else {
       std::byte id = static_cast<std::byte>(c) | T;
-      auto cnt = cnts[id]++;
+      auto cnt = cnts[std::to_integer<std::size_t>(id)]++;
       specific(T, c, cnt, b);
     }
   });
 }
+#endif
 
-} // namespace atr
\ No newline at end of file
+} // namespace atr
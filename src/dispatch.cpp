@@ -0,0 +1,197 @@
+#include "dispatch.hpp"
+
+#include <algorithm>
+
+namespace atr {
+namespace {
+// entries taken from a ring before it is released for other workers
+constexpr std::size_t batch = 8;
+// unsuccessful rounds before a worker yields and before it sleeps
+constexpr unsigned spins_before_yield = 64;
+constexpr unsigned spins_before_park = 256;
+
+std::size_t round_up_pow2(std::size_t n) {
+  std::size_t size = 1;
+  while (size < n)
+    size <<= 1;
+  return size;
+}
+} // namespace
+
+dispatcher::dispatcher(std::size_t readers, std::size_t workers, profile p,
+                       std::size_t ring_size, std::size_t completion_size)
+    : readers_(readers), workers_(std::max<std::size_t>(workers, 1)),
+      profile_(p),
+      rings_(std::make_unique<ring[]>(readers)),
+      cells_(std::make_unique<cell[]>(round_up_pow2(completion_size))),
+      cell_mask_(round_up_pow2(completion_size) - 1) {
+  ring_size = round_up_pow2(ring_size);
+  for (std::size_t r = 0; r < readers; r++) {
+    rings_[r].entries = std::make_unique<entry[]>(ring_size);
+    rings_[r].mask = ring_size - 1;
+  }
+  for (std::size_t i = 0; i <= cell_mask_; i++)
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+
+  threads_.reserve(workers_);
+  for (std::size_t w = 0; w < workers_; w++)
+    threads_.emplace_back([this, w] { work(w); });
+}
+
+dispatcher::~dispatcher() {
+  stop_.store(true, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    work_available_.notify_all();
+    space_available_.notify_all();
+  }
+  for (auto &t : threads_)
+    t.join();
+}
+
+bool dispatcher::submit(std::size_t reader, gsl::span<const std::byte> bytes) {
+  auto &r = rings_[reader];
+  if (bytes.size() > max_atr_size)
+    return false;
+  const auto tail = r.tail.load(std::memory_order_relaxed);
+  if (tail - r.head.load(std::memory_order_acquire) > r.mask)
+    return false;
+
+  auto &e = r.entries[tail & r.mask];
+  std::copy(bytes.begin(), bytes.end(), e.bytes.begin());
+  e.size = static_cast<std::uint8_t>(bytes.size());
+  e.sequence = r.submitted++;
+  const bool was_empty = tail == r.head.load(std::memory_order_relaxed);
+  r.tail.store(tail + 1, std::memory_order_release);
+
+  // pairs with the fence in work(): either the worker sees the new tail or
+  // we see it parked
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (was_empty && parked_.load(std::memory_order_relaxed) != 0) {
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    work_available_.notify_one();
+  }
+  return true;
+}
+
+std::optional<dispatcher::completion> dispatcher::poll() {
+  const auto pos = dequeue_.load(std::memory_order_relaxed);
+  auto &c = cells_[pos & cell_mask_];
+  if (c.sequence.load(std::memory_order_acquire) != pos + 1)
+    return {};
+  auto result = std::move(c.value);
+  c.sequence.store(pos + cell_mask_ + 1, std::memory_order_release);
+  dequeue_.store(pos + 1, std::memory_order_relaxed);
+
+  // pairs with the fence in complete()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (blocked_.load(std::memory_order_relaxed) != 0) {
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    space_available_.notify_all();
+  }
+  return result;
+}
+
+void dispatcher::work(std::size_t worker) {
+  unsigned idle = 0;
+  while (!stop_.load(std::memory_order_acquire)) {
+    // own readers first, then steal from the other workers
+    bool found = false;
+    for (std::size_t k = 0; k < workers_ && !found; k++)
+      found = drain((worker + k) % workers_);
+
+    if (found) {
+      idle = 0;
+    } else if (++idle > spins_before_park) {
+      std::unique_lock<std::mutex> lock(park_mutex_);
+      parked_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!stop_.load(std::memory_order_acquire) && !pending())
+        work_available_.wait(lock);
+      parked_.fetch_sub(1, std::memory_order_relaxed);
+      idle = 0;
+    } else if (idle > spins_before_yield) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool dispatcher::pending() const noexcept {
+  for (std::size_t reader = 0; reader < readers_; reader++) {
+    const auto &r = rings_[reader];
+    if (r.head.load(std::memory_order_relaxed) !=
+        r.tail.load(std::memory_order_acquire))
+      return true;
+  }
+  return false;
+}
+
+bool dispatcher::drain(std::size_t group) {
+  bool found = false;
+  for (auto reader = group; reader < readers_; reader += workers_) {
+    auto &r = rings_[reader];
+    if (r.head.load(std::memory_order_relaxed) ==
+        r.tail.load(std::memory_order_acquire))
+      continue;
+    if (r.claimed.test_and_set(std::memory_order_acquire))
+      continue;
+
+    auto head = r.head.load(std::memory_order_relaxed);
+    const auto tail = r.tail.load(std::memory_order_acquire);
+    const auto end = std::min(tail, head + batch);
+    for (; head != end; head++) {
+      const auto &e = r.entries[head & r.mask];
+      completion c{reader, e.sequence, std::nullopt, {}};
+      try {
+        c.result.emplace(gsl::span<const std::byte>(e.bytes).first(e.size),
+                         profile_);
+      } catch (const invalid_atr &ex) {
+        c.error = ex.what();
+      }
+      // the entry is released before publishing to unblock the producer
+      r.head.store(head + 1, std::memory_order_release);
+      complete(std::move(c));
+      found = true;
+    }
+    r.claimed.clear(std::memory_order_release);
+  }
+  return found;
+}
+
+void dispatcher::complete(completion &&value) {
+  auto pos = enqueue_.load(std::memory_order_relaxed);
+  unsigned spins = 0;
+  for (;;) {
+    auto &c = cells_[pos & cell_mask_];
+    const auto seq = c.sequence.load(std::memory_order_acquire);
+    if (seq == pos) {
+      if (enqueue_.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+        c.value = std::move(value);
+        c.sequence.store(pos + 1, std::memory_order_release);
+        return;
+      }
+    } else if (seq < pos) {
+      // queue is full, wait for the consumer
+      if (stop_.load(std::memory_order_acquire))
+        return;
+      if (++spins > spins_before_park) {
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        blocked_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!stop_.load(std::memory_order_acquire) &&
+            c.sequence.load(std::memory_order_acquire) < pos)
+          space_available_.wait(lock);
+        blocked_.fetch_sub(1, std::memory_order_relaxed);
+        spins = 0;
+      } else {
+        std::this_thread::yield();
+      }
+      pos = enqueue_.load(std::memory_order_relaxed);
+    } else {
+      pos = enqueue_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+} // namespace atr
@@ -0,0 +1,90 @@
+#include "edc.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace atr {
+namespace {
+constexpr std::uint16_t crc_polynomial = 0x8408;
+
+// tables[0] is the classic byte-wise table, tables[k] advances the CRC of a
+// byte by k additional zero bytes
+constexpr auto crc_tables = []() {
+  std::array<std::array<std::uint16_t, 256>, 8> tables{};
+  for (std::size_t i = 0; i < 256; i++) {
+    auto value = static_cast<std::uint16_t>(i);
+    for (int bit = 0; bit < 8; bit++)
+      value = (value & 1) ? (value >> 1) ^ crc_polynomial : (value >> 1);
+    tables[0][i] = value;
+  }
+  for (std::size_t k = 1; k < tables.size(); k++) {
+    for (std::size_t i = 0; i < 256; i++) {
+      const auto prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xff];
+    }
+  }
+  return tables;
+}();
+
+std::uint8_t u8(std::byte b) { return std::to_integer<std::uint8_t>(b); }
+} // namespace
+
+lrc &lrc::update(gsl::span<const std::byte> data) noexcept {
+  // XOR 32 bytes at a time into independent lanes, the compiler turns this
+  // into vector code
+  constexpr std::size_t lanes = 4;
+  std::uint64_t wide[lanes] = {};
+  std::size_t i = 0;
+  for (; i + sizeof(wide) <= data.size(); i += sizeof(wide)) {
+    std::uint64_t words[lanes];
+    std::memcpy(words, data.data() + i, sizeof(words));
+    for (std::size_t lane = 0; lane < lanes; lane++)
+      wide[lane] ^= words[lane];
+  }
+  auto folded = wide[0] ^ wide[1] ^ wide[2] ^ wide[3];
+  folded ^= folded >> 32;
+  folded ^= folded >> 16;
+  folded ^= folded >> 8;
+  auto value = value_ ^ static_cast<std::byte>(folded & 0xff);
+  for (; i < data.size(); i++)
+    value ^= data[i];
+  value_ = value;
+  return *this;
+}
+
+crc &crc::update(gsl::span<const std::byte> data) noexcept {
+  const auto &t = crc_tables;
+  auto value = value_;
+  const auto *p = data.data();
+  auto size = data.size();
+  for (; size >= 8; size -= 8, p += 8) {
+    value ^= static_cast<std::uint16_t>(u8(p[0]) | (u8(p[1]) << 8));
+    value = t[7][value & 0xff] ^ t[6][value >> 8] ^ t[5][u8(p[2])] ^
+            t[4][u8(p[3])] ^ t[3][u8(p[4])] ^ t[2][u8(p[5])] ^
+            t[1][u8(p[6])] ^ t[0][u8(p[7])];
+  }
+  for (; size; size--, p++)
+    value = (value >> 8) ^ t[0][(value ^ u8(*p)) & 0xff];
+  value_ = value;
+  return *this;
+}
+
+edc &edc::update(gsl::span<const std::byte> data) noexcept {
+  if (code_ == redundancy_code::LRC)
+    lrc_.update(data);
+  else
+    crc_.update(data);
+  return *this;
+}
+
+gsl::span<std::byte> edc::write(gsl::span<std::byte> out) const noexcept {
+  if (code_ == redundancy_code::LRC) {
+    out[0] = lrc_.value();
+    return out.first(1);
+  }
+  out[0] = static_cast<std::byte>(crc_.value() >> 8);
+  out[1] = static_cast<std::byte>(crc_.value());
+  return out.first(2);
+}
+
+} // namespace atr
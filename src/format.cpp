@@ -0,0 +1,338 @@
+#include "format.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+#include "utility.hpp"
+
+namespace atr {
+namespace {
+constexpr char hex_digits[] = "0123456789ABCDEF";
+
+constexpr std::string_view clockstop_names[] = {"not_supported", "low", "high",
+                                                "no_preference"};
+
+// appends to a fixed buffer, remembers if anything did not fit
+class writer {
+  char *pos_;
+  char *end_;
+  bool overflow_ = false;
+
+public:
+  explicit writer(gsl::span<char> out)
+      : pos_(out.data()), end_(out.data() + out.size()) {}
+
+  writer &str(std::string_view s) noexcept {
+    if (static_cast<std::size_t>(end_ - pos_) < s.size()) {
+      overflow_ = true;
+      return *this;
+    }
+    std::memcpy(pos_, s.data(), s.size());
+    pos_ += s.size();
+    return *this;
+  }
+  writer &chr(char c) noexcept {
+    if (pos_ == end_)
+      overflow_ = true;
+    else
+      *pos_++ = c;
+    return *this;
+  }
+  writer &hex(std::byte b) noexcept { return hex(&b, 1); }
+  writer &hex(gsl::span<const std::byte> bytes) noexcept {
+    return hex(bytes.data(), bytes.size());
+  }
+  writer &hex(const std::byte *bytes, std::size_t size) noexcept {
+    if (static_cast<std::size_t>(end_ - pos_) < 2 * size) {
+      overflow_ = true;
+      return *this;
+    }
+    for (std::size_t i = 0; i < size; i++) {
+      const auto v = std::to_integer<unsigned>(bytes[i]);
+      *pos_++ = hex_digits[v >> 4];
+      *pos_++ = hex_digits[v & 0x0f];
+    }
+    return *this;
+  }
+  writer &num(long long v) noexcept {
+    const auto result = std::to_chars(pos_, end_, v);
+    if (result.ec != std::errc{})
+      overflow_ = true;
+    else
+      pos_ = result.ptr;
+    return *this;
+  }
+
+  char *pos() const noexcept { return pos_; }
+  bool overflow() const noexcept { return overflow_; }
+};
+
+// key/value pairs as lines of text or members of a JSON object
+class record {
+  writer &w_;
+  const bool json_;
+  bool first_ = true;
+  std::string_view group_;
+
+public:
+  record(writer &w, dump_format format)
+      : w_(w), json_(format == dump_format::json) {
+    if (json_)
+      w_.chr('{');
+  }
+
+  writer &key(std::string_view name) noexcept {
+    if (json_)
+      w_.str(first_ ? "\"" : ",\"").str(name).str("\":");
+    else if (group_.empty())
+      w_.str(first_ ? "" : "\n").str(name).chr(' ');
+    else
+      w_.str(first_ ? "" : "\n").str(group_).chr('[').str(name).str("] ");
+    first_ = false;
+    return w_;
+  }
+  // a nested object in JSON, keys are written as group[key] in text
+  void begin(std::string_view group) noexcept {
+    if (json_) {
+      key(group).chr('{');
+      first_ = true;
+    } else {
+      group_ = group;
+    }
+  }
+  void end() noexcept {
+    if (json_)
+      w_.chr('}');
+    first_ = false;
+    group_ = {};
+  }
+  // strings are quoted in JSON only, they never contain quotes
+  writer &quote() noexcept { return json_ ? w_.chr('"') : w_; }
+  bool json() const noexcept { return json_; }
+
+  void number(std::string_view name, long long v) noexcept {
+    key(name).num(v);
+  }
+  void string(std::string_view name, std::string_view v) noexcept {
+    key(name);
+    quote().str(v);
+    quote();
+  }
+  void hex(std::string_view name, gsl::span<const std::byte> bytes) noexcept {
+    key(name);
+    quote().hex(bytes);
+    quote();
+  }
+  void duration(std::string_view name, atr_view::duration d) noexcept {
+    number(name, std::llround(d.count() * 1e9));
+  }
+  void finish() noexcept {
+    if (json_)
+      w_.chr('}');
+  }
+};
+
+// class indicator bits of the first TA for T=15 as letters
+void classes(writer &w, std::byte indicator) {
+  for (const auto cls : {'A', 'B', 'C'})
+    if ((indicator & static_cast<std::byte>(1 << (cls - 'A'))) != 0_b)
+      w.chr(cls);
+}
+
+// ISO7816-3:2006, 8.3 Global interface bytes & 11.4 Specific interface bytes
+void meaning(writer &w, const atr_view &atr, if_char c, int block, int T,
+             std::byte b) {
+  const auto high = std::to_integer<std::size_t>(b >> 4);
+  const auto low = std::to_integer<std::size_t>(b & 0x0f_b);
+  if (c == if_char::D) {
+    w.str("T=").num(low);
+  } else if (block == 1) {
+    switch (c) {
+    case if_char::A:
+      w.str("Fi=").num(Fi_lookup[high]).str(" Di=").num(Di_lookup[low]);
+      w.str(" FMax=").num(FMax_lookup[high]);
+      break;
+    case if_char::B:
+      w.str("VPP (deprecated)");
+      break;
+    default:
+      w.str("N=").num(std::to_integer<int>(b));
+      break;
+    }
+  } else if (block == 2) {
+    switch (c) {
+    case if_char::A:
+      w.str("specific mode T=").num(atr.specific_mode_T());
+      if (atr.specific_change_capable())
+        w.str(" change capable");
+      if (atr.implicit_divider())
+        w.str(" implicit F/D");
+      break;
+    case if_char::B:
+      w.str("PI2 (deprecated)");
+      break;
+    default:
+      w.str("WI=").num(std::to_integer<int>(b));
+      break;
+    }
+  } else if (T == 1) {
+    switch (c) {
+    case if_char::A:
+      w.str("IFSC=").num(std::to_integer<int>(b));
+      break;
+    case if_char::B:
+      w.str("BWI=").num(high).str(" CWI=").num(low);
+      break;
+    default:
+      w.str((b & 0x01_b) == 0_b ? "LRC" : "CRC");
+      break;
+    }
+  } else if (T == 15 && c == if_char::A) {
+    w.str("clock stop ").str(clockstop_names[high >> 2]).str(" classes ");
+    classes(w, b & 0x3f_b);
+  } else if (T == 15 && c == if_char::B) {
+    w.str("SPU");
+  } else {
+    w.str("T=").num(T).str(" specific");
+  }
+}
+} // namespace
+
+gsl::span<char> dump(const atr_view &atr, gsl::span<char> out,
+                     dump_format format, int freq) {
+  writer w(out);
+  record r(w, format);
+  const auto bytes = atr.bytes();
+
+  r.key("TS");
+  r.quote().hex(bytes[0]).str(bytes[0] == 0x3B_b ? " direct" : " inverse");
+  r.quote();
+  r.key("T0");
+  r.quote().hex(bytes[1]).str(" K=").num(atr.historical_bytes().size());
+  r.quote();
+
+  // interface bytes, T is the protocol the bytes of a block belong to
+  int T = 0;
+  std::uint16_t offered = 1; // T=0 unless TD1 indicates otherwise
+  for (int block = 1;; block++) {
+    for (const auto c : {if_char::A, if_char::B, if_char::C, if_char::D}) {
+      const auto b = atr.intf_char(c, block);
+      if (!b)
+        continue;
+      char name[8] = {'T', to_char(c)};
+      const auto end = std::to_chars(name + 2, std::end(name), block).ptr;
+      r.key(std::string_view(name, static_cast<std::size_t>(end - name)));
+      if (r.json())
+        w.str("{\"value\":\"").hex(*b).str("\",\"meaning\":\"");
+      else
+        w.hex(*b).chr(' ');
+      meaning(w, atr, c, block, T, *b);
+      if (r.json())
+        w.str("\"}");
+    }
+    const auto TD = atr.intf_char(if_char::D, block);
+    if (!TD)
+      break;
+    T = std::to_integer<int>(*TD & 0x0f_b);
+    if (block == 1)
+      offered = 0;
+    offered = static_cast<std::uint16_t>(offered | 1u << T);
+  }
+
+  r.key("T");
+  w.str(r.json() ? "[" : "");
+  bool first = true;
+  for (int t = 0; t < 16; t++) {
+    if ((offered & (1u << t)) == 0)
+      continue;
+    w.str(first ? "" : (r.json() ? "," : " ")).num(t);
+    first = false;
+  }
+  w.str(r.json() ? "]" : "");
+
+  r.number("Fi", atr.Fi());
+  r.number("Di", atr.Di());
+  r.number("FMax", atr.FMax());
+  r.number("freq", freq);
+
+  const auto F = atr.Fi();
+  const auto D = atr.Di();
+  r.duration("GT_ns", atr.gt(F, D, freq));
+  r.duration("WT_ns", atr.wt(freq));
+  if ((offered & 0x02) != 0) {
+    r.duration("CGT_ns", atr.cgt(F, D, freq));
+    r.duration("BGT_ns", atr.bgt(F, D, freq));
+    r.duration("CWT_ns", atr.cwt(F, D, freq));
+    r.duration("BWT_ns", atr.bwt(F, D, freq));
+  }
+
+  r.string("clockstop",
+           clockstop_names[static_cast<std::size_t>(atr.clockstop())]);
+  r.key("classes");
+  r.quote();
+  classes(w, static_cast<std::byte>(atr.classes()));
+  r.quote();
+
+  r.hex("historical", atr.historical_bytes());
+  const auto historical_end =
+      atr.historical_bytes().data() + atr.historical_bytes().size();
+  if (historical_end != bytes.data() + bytes.size())
+    r.hex("TCK", bytes.last(1));
+  r.finish();
+
+  if (w.overflow())
+    return {};
+  return out.first(static_cast<std::size_t>(w.pos() - out.data()));
+}
+
+gsl::span<char> dump(const metrics::snapshot &s, gsl::span<char> out,
+                     dump_format format) {
+  writer w(out);
+  record r(w, format);
+  char name[24];
+  auto number_name = [&](std::uint64_t v, int base = 10) {
+    const auto end = std::to_chars(std::begin(name), std::end(name), v, base);
+    return std::string_view(name, static_cast<std::size_t>(end.ptr - name));
+  };
+
+  r.number("accepted", static_cast<long long>(s.accepted));
+  r.begin("rejected");
+  for (std::size_t i = 1; i < s.rejected.size(); i++)
+    if (s.rejected[i] != 0)
+      r.number(message(static_cast<rule>(i)),
+               static_cast<long long>(s.rejected[i]));
+  r.end();
+  r.begin("T");
+  for (std::size_t T = 0; T < s.protocols.size(); T++)
+    if (s.protocols[T] != 0)
+      r.number(number_name(T), static_cast<long long>(s.protocols[T]));
+  r.end();
+  r.begin("TA1");
+  for (std::size_t TA1 = 0; TA1 < s.TA1.size(); TA1++)
+    if (s.TA1[TA1] != 0)
+      r.number(number_name(TA1, 16), static_cast<long long>(s.TA1[TA1]));
+  if (s.TA1_absent != 0)
+    r.number("absent", static_cast<long long>(s.TA1_absent));
+  r.end();
+
+  // histograms keyed by the upper bound of the bucket in ns
+  auto histogram = [&](std::string_view group, const metrics::histogram &h) {
+    r.begin(group);
+    for (std::size_t i = 0; i < h.size(); i++)
+      if (h[i] != 0)
+        r.number(number_name(std::uint64_t{1} << i),
+                 static_cast<long long>(h[i]));
+    r.end();
+  };
+  histogram("parse_ns", s.parse_ns);
+  histogram("receive_ns", s.receive_ns);
+  r.finish();
+
+  if (w.overflow())
+    return {};
+  return out.first(static_cast<std::size_t>(w.pos() - out.data()));
+}
+
+} // namespace atr
@@ -0,0 +1,128 @@
+#include "metrics.hpp"
+
+#ifdef ATR_ENABLE_METRICS
+#include <algorithm>
+#include <atomic>
+
+#include "utility.hpp"
+#endif
+
+namespace atr {
+namespace metrics {
+
+#ifdef ATR_ENABLE_METRICS
+namespace {
+using counter = std::atomic<std::uint64_t>;
+
+// Threads are spread over a few shards of relaxed atomic counters, so that
+// counting is wait-free and rarely contended while collect() can read any
+// shard at any time.
+struct alignas(64) shard {
+  counter accepted;
+  std::array<counter, rule_count> rejected;
+  std::array<counter, 16> protocols;
+  std::array<counter, 256> TA1;
+  counter TA1_absent;
+  std::array<counter, latency_buckets> parse_ns;
+  std::array<counter, latency_buckets> receive_ns;
+};
+
+constexpr std::size_t shard_count = 16;
+// zero initialized as objects of static storage duration
+shard shards[shard_count];
+std::atomic<std::size_t> next_shard{0};
+
+shard &local() noexcept {
+  thread_local shard &s =
+      shards[next_shard.fetch_add(1, std::memory_order_relaxed) %
+             shard_count];
+  return s;
+}
+
+void add(counter &c) noexcept { c.fetch_add(1, std::memory_order_relaxed); }
+
+std::size_t bucket(std::chrono::nanoseconds d) noexcept {
+  auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(d.count(), 0));
+  std::size_t i = 0;
+  while (ns != 0 && i < latency_buckets - 1) {
+    ns >>= 1;
+    i++;
+  }
+  return i;
+}
+
+template <std::size_t N>
+void sum(std::array<std::uint64_t, N> &to,
+         const std::array<counter, N> &from) noexcept {
+  for (std::size_t i = 0; i < N; i++)
+    to[i] += from[i].load(std::memory_order_relaxed);
+}
+
+template <std::size_t N> void clear(std::array<counter, N> &counters) noexcept {
+  for (auto &c : counters)
+    c.store(0, std::memory_order_relaxed);
+}
+} // namespace
+
+void rejected(rule r) noexcept {
+  add(local().rejected[static_cast<std::size_t>(r)]);
+}
+
+void accepted(const atr_view &atr, const stopwatch &watch) noexcept {
+  auto &s = local();
+  add(s.accepted);
+  add(s.parse_ns[bucket(watch.elapsed())]);
+
+  if (const auto TA1 = atr.intf_char(if_char::A, 1))
+    add(s.TA1[std::to_integer<std::size_t>(*TA1)]);
+  else
+    add(s.TA1_absent);
+
+  // ISO7816-3:2006, 8.2.3 Interface bytes: T=0 if TD1 is absent
+  if (!atr.intf_char(if_char::D, 1))
+    add(s.protocols[0]);
+  for (int i = 1;; i++) {
+    const auto TD = atr.intf_char(if_char::D, i);
+    if (!TD)
+      break;
+    add(s.protocols[std::to_integer<std::size_t>(*TD & 0x0f_b)]);
+  }
+}
+
+void received(const stopwatch &watch) noexcept {
+  add(local().receive_ns[bucket(watch.elapsed())]);
+}
+#endif
+
+snapshot collect() noexcept {
+  snapshot result;
+#ifdef ATR_ENABLE_METRICS
+  for (const auto &s : shards) {
+    result.accepted += s.accepted.load(std::memory_order_relaxed);
+    sum(result.rejected, s.rejected);
+    sum(result.protocols, s.protocols);
+    sum(result.TA1, s.TA1);
+    result.TA1_absent += s.TA1_absent.load(std::memory_order_relaxed);
+    sum(result.parse_ns, s.parse_ns);
+    sum(result.receive_ns, s.receive_ns);
+  }
+#endif
+  return result;
+}
+
+void reset() noexcept {
+#ifdef ATR_ENABLE_METRICS
+  for (auto &s : shards) {
+    s.accepted.store(0, std::memory_order_relaxed);
+    clear(s.rejected);
+    clear(s.protocols);
+    clear(s.TA1);
+    s.TA1_absent.store(0, std::memory_order_relaxed);
+    clear(s.parse_ns);
+    clear(s.receive_ns);
+  }
+#endif
+}
+
+} // namespace metrics
+} // namespace atr
@@ -0,0 +1,125 @@
+#include "pps.hpp"
+
+#include "utility.hpp"
+
+namespace atr {
+namespace pps {
+namespace {
+constexpr std::byte PPSS = 0xFF_b;
+constexpr std::byte PPS1_present = 0x10_b;
+constexpr std::byte PPS2_present = 0x20_b;
+constexpr std::byte PPS3_present = 0x40_b;
+
+// default values of Fd and Dd, used if PPS1 is not part of the response
+constexpr int Fd = 372;
+constexpr int Dd = 1;
+
+bool offered(const atr_view &atr, int T) noexcept {
+  for (int i = 1;; i++) {
+    const auto TD = atr.intf_char(if_char::D, i);
+    if (!TD)
+      return i == 1 && T == 0;
+    if (std::to_integer<int>(*TD & 0x0f_b) == T)
+      return true;
+  }
+}
+
+std::byte pps0(const request &req) {
+  return static_cast<std::byte>(req.T) | (req.PPS1 ? PPS1_present : 0_b) |
+         (req.PPS2 ? PPS2_present : 0_b) | (req.PPS3 ? PPS3_present : 0_b);
+}
+} // namespace
+
+availability available(const atr_view &atr, int T) noexcept {
+  if (T < 0 || T > 14)
+    return availability::none;
+  if (atr.specific_mode())
+    return atr.specific_change_capable() ? availability::warm_reset
+                                         : availability::none;
+  return offered(atr, T) ? availability::available : availability::none;
+}
+
+std::optional<request> propose(const atr_view &atr, int T) {
+  if (available(atr, T) != availability::available)
+    return {};
+
+  request req{T, {}, {}, {}};
+  const auto TA1 = atr.intf_char(if_char::A, 1);
+  if (TA1 && *TA1 != 0x11_b)
+    req.PPS1 = TA1;
+  return req;
+}
+
+gsl::span<std::byte> encode(const request &req, gsl::span<std::byte> out) {
+  std::size_t size = 0;
+  auto append = [&](std::byte b) {
+    if (size < out.size())
+      out[size] = b;
+    size++;
+  };
+
+  append(PPSS);
+  append(pps0(req));
+  for (const auto &parameter : {req.PPS1, req.PPS2, req.PPS3})
+    if (parameter)
+      append(*parameter);
+
+  if (size >= out.size())
+    return {};
+  std::byte pck = 0_b;
+  for (std::size_t i = 0; i < size; i++)
+    pck ^= out[i];
+  append(pck);
+  return out.first(size);
+}
+
+std::size_t expected_size(gsl::span<const std::byte> received) {
+  if (received.size() < 2)
+    return (received.size() < 1 || received[0] == PPSS) ? 2 : 0;
+  if (received[0] != PPSS)
+    return 0;
+  return 3 + popcount(received[1] & 0x70_b);
+}
+
+std::optional<result> validate(const request &req,
+                               gsl::span<const std::byte> response) {
+  // ISO7816-3:2006, 9.3 Successful PPS exchange
+  if (expected_size(response) != response.size())
+    return {};
+
+  std::byte pck = 0_b;
+  for (const auto b : response)
+    pck ^= b;
+  if (pck != 0_b)
+    return {};
+
+  const auto request_pps0 = pps0(req);
+  const auto response_pps0 = response[1];
+  if ((response_pps0 & 0x8f_b) != (request_pps0 & 0x8f_b))
+    return {};
+
+  // every parameter is either echoed or absent (not accepted)
+  std::size_t idx = 2;
+  std::optional<std::byte> accepted[3];
+  const std::optional<std::byte> requested[] = {req.PPS1, req.PPS2, req.PPS3};
+  const std::byte present[] = {PPS1_present, PPS2_present, PPS3_present};
+  for (std::size_t i = 0; i < 3; i++) {
+    if ((response_pps0 & present[i]) == 0_b)
+      continue;
+    if (!requested[i] || response[idx] != *requested[i])
+      return {};
+    accepted[i] = response[idx++];
+  }
+
+  result res{req.T, Fd, Dd};
+  if (accepted[0]) {
+    res.F = Fi_lookup[std::to_integer<std::size_t>(*accepted[0] >> 4)];
+    res.D = Di_lookup[std::to_integer<std::size_t>(*accepted[0] & 0x0f_b)];
+    if (res.F == 0 || res.D == 0)
+      return {};
+  }
+  return res;
+}
+
+} // namespace pps
+} // namespace atr
@@ -1,11 +1,113 @@
 #include "atr.hpp"
+#include "metrics.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace atr {
 
-std::vector<std::byte>
-receive(std::function<bool(gsl::span<std::byte> buffer)> recv_func) {
-  constexpr std::size_t max_atr_size = 32;
+namespace {
+struct layout {
+  std::size_t size; // 0 if the bytes can not start an ATR
+  bool tck;         // TCK present, only known once size bytes are available
+};
+
+// size of the ATR starting at received[0] as far as known, TS is not checked
+layout atr_layout(gsl::span<const std::byte> received) {
+  auto TDx = received[1];
+  const auto K = std::to_integer<std::size_t>(received[1] & 0x0f_b);
+  bool needs_tck = false;
+  std::size_t tdx_offset = 1;
+  while ((TDx & 0x80_b) != 0_b) {
+    tdx_offset += popcount(TDx & 0xf0_b);
+    if (tdx_offset >= max_atr_size)
+      return {0, false};
+    if (tdx_offset >= received.size())
+      return {tdx_offset + 1, false};
+
+    TDx = received[tdx_offset];
+    if ((TDx & 0x0f_b) != 0_b)
+      needs_tck = true;
+  }
+
+  const auto size = tdx_offset + popcount(TDx & 0xf0_b) + 1 + K +
+                    (needs_tck ? 1 : 0);
+  return {size <= max_atr_size ? size : 0, needs_tck};
+}
+} // namespace
+
+std::size_t expected_size(gsl::span<const std::byte> received) {
+  if (received.size() < 2)
+    return received.size() < 1 || received[0] == 0x3B_b ? 2 : 0;
+  if (received[0] != 0x3B_b)
+    return 0;
+  return atr_layout(received).size;
+}
+
+scan_result scan(gsl::span<const std::byte> buffered, profile p,
+                 bool end_of_stream) noexcept {
+  const auto size = buffered.size();
+  if (size == 0)
+    return {};
+  // offset of the next byte c at or after from, memchr is vectorized
+  auto find = [&](unsigned char c, std::size_t from) -> std::size_t {
+    const auto hit = std::memchr(buffered.data() + from, c, size - from);
+    return hit ? static_cast<std::size_t>(static_cast<const std::byte *>(hit) -
+                                          buffered.data())
+               : size;
+  };
+
+  // the candidates for TS in order, direct (3B) and inverse (3F) convention
+  std::size_t next_direct = find(0x3B, 0);
+  std::size_t next_inverse = find(0x3F, 0);
+  while (true) {
+    const auto pos = std::min(next_direct, next_inverse);
+    if (pos == size)
+      break;
+    if (pos == next_direct)
+      next_direct = find(0x3B, pos + 1);
+    else
+      next_inverse = find(0x3F, pos + 1);
+
+    const auto candidate = buffered.subspan(pos);
+    const auto l = candidate.size() < 2 ? layout{2, false}
+                                        : atr_layout(candidate);
+    if (l.size == 0)
+      continue;
+    // an ATR found in the bytes of this candidate could be part of it,
+    // unless the candidate can not be completed any more
+    if (l.size > candidate.size()) {
+      if (end_of_stream)
+        continue;
+      return {std::nullopt, pos};
+    }
+
+    // checking the TCK first avoids parsing most of the false candidates
+    const auto bytes = candidate.first(l.size);
+    if (l.tck) {
+      std::byte check_value = 0_b;
+      for (const auto b : bytes.subspan(1))
+        check_value ^= b;
+      if (check_value != 0_b)
+        continue;
+    }
+    // only the returned ATR is counted, rescanning the same bytes with more
+    // appended would count the rejected candidates again
+    const metrics::stopwatch watch;
+    if (auto view = atr_view::decode(bytes, p)) {
+      metrics::accepted(*view, watch);
+      return {view, pos};
+    }
+  }
+  return {std::nullopt, size};
+}
+
+#ifndef ATR_FREESTANDING
+std::pmr::vector<std::byte>
+receive(std::function<bool(gsl::span<std::byte> buffer)> recv_func,
+        const std::pmr::polymorphic_allocator<std::byte> &alloc) {
+  const metrics::stopwatch watch;
   std::array<std::byte, max_atr_size> memory;
   gsl::span<std::byte> remaining(memory);
   bool needs_tck = false;
@@ -48,7 +150,51 @@ receive(std::function<bool(gsl::span<std::byte> buffer)> recv_func) {
     remaining = remaining.subspan(1);
   }
 
-  return {memory.begin(), memory.end() - remaining.size()};
+  metrics::received(watch);
+  return {memory.begin(), memory.end() - remaining.size(), alloc};
+}
+
+receiver::receiver(read_function read_func)
+    : read_func_(std::move(read_func)) {}
+
+gsl::span<std::byte> receiver::receive(gsl::span<std::byte> buffer) {
+  const metrics::stopwatch watch;
+  std::size_t size;
+  while ((size = expected_size(pending())) > end_ - begin_) {
+    if (end_ == buffer_.size()) {
+      std::copy(buffer_.begin() + begin_, buffer_.end(), buffer_.begin());
+      end_ -= begin_;
+      begin_ = 0;
+    }
+
+    const auto received =
+        read_func_(gsl::span<std::byte>(buffer_).subspan(end_));
+    if (received == 0 || received > buffer_.size() - end_) {
+      size = 0;
+      break;
+    }
+    end_ += received;
+  }
+
+  if (size == 0 || size > buffer.size()) {
+    reset();
+    return {};
+  }
+
+  std::copy_n(buffer_.begin() + begin_, size, buffer.begin());
+  begin_ += size;
+  metrics::received(watch);
+  return buffer.first(size);
+}
+
+gsl::span<const std::byte> receiver::pending() const noexcept {
+  return gsl::span<const std::byte>(buffer_).subspan(begin_, end_ - begin_);
+}
+
+void receiver::reset() noexcept {
+  begin_ = 0;
+  end_ = 0;
 }
+#endif
 
-} // namespace atr
\ No newline at end of file
+} // namespace atr
@@ -0,0 +1,204 @@
+#include "session.hpp"
+
+#include <algorithm>
+
+#include "utility.hpp"
+
+namespace atr {
+namespace {
+using clock = session::clock;
+
+constexpr int Fd = 372;
+constexpr int Dd = 1;
+
+// turns the timer heap into a min heap
+constexpr auto expires_later = [](const auto &a, const auto &b) {
+  return a.deadline > b.deadline;
+};
+
+clock::duration to_clock(atr::duration d) {
+  return std::chrono::ceil<clock::duration>(d);
+}
+
+// protocol to use: the first offered one supported by the session
+std::optional<int> select_protocol(const atr_view &atr) {
+  const auto TD1 = atr.intf_char(if_char::D, 1);
+  if (!TD1)
+    return 0;
+  for (int i = 1;; i++) {
+    const auto TD = atr.intf_char(if_char::D, i);
+    if (!TD)
+      return {};
+    const auto T = std::to_integer<int>(*TD & 0x0f_b);
+    if (T == 0 || T == 1)
+      return T;
+  }
+}
+} // namespace
+
+session_pool::session_pool(std::size_t sessions, int freq, send_function send,
+                           event_function on_change)
+    : sessions_(sessions), freq_(freq),
+      initial_wait_(to_clock(atr::duration(40'000.0 / freq))),
+      atr_character_wait_(to_clock(atr::duration(9'600.0 * Fd / Dd / freq))),
+      send_(std::move(send)), on_change_(std::move(on_change)) {
+  timers_.reserve(sessions);
+}
+
+void session_pool::reset(std::size_t id, clock::time_point now) {
+  auto &s = sessions_[id];
+  s.atr_size_ = 0;
+  s.pps_size_ = 0;
+  s.state_ = session_state::receiving_atr;
+  s.protocol_ = protocol_state::PPS;
+  s.pps_availability_ = pps::availability::none;
+  s.F_ = Fd;
+  s.D_ = Dd;
+  arm(id, s, now + initial_wait_);
+}
+
+void session_pool::on_bytes(std::size_t id, gsl::span<const std::byte> bytes,
+                            clock::time_point now) {
+  auto &s = sessions_[id];
+  for (const auto b : bytes)
+    on_byte(id, s, b, now);
+}
+
+void session_pool::advance(clock::time_point now) {
+  while (!timers_.empty() && timers_.front().deadline <= now) {
+    std::pop_heap(timers_.begin(), timers_.end(), expires_later);
+    const auto t = timers_.back();
+    timers_.pop_back();
+
+    auto &s = sessions_[t.id];
+    // superseded by an earlier timer of the same session
+    if (!s.timer_queued_ || t.deadline != s.queued_)
+      continue;
+    s.timer_queued_ = false;
+
+    if (s.state_ != session_state::receiving_atr &&
+        s.state_ != session_state::negotiating)
+      continue;
+    if (s.deadline_ > now)
+      arm(t.id, s, s.deadline_);
+    else
+      fail(t.id, s);
+  }
+}
+
+session_pool::clock::time_point session_pool::next_deadline() const noexcept {
+  return timers_.empty() ? clock::time_point::max()
+                         : timers_.front().deadline;
+}
+
+void session_pool::on_byte(std::size_t id, session &s, std::byte b,
+                           clock::time_point now) {
+  switch (s.state_) {
+  case session_state::receiving_atr: {
+    if (s.atr_size_ == s.atr_.size())
+      return fail(id, s);
+    s.atr_[s.atr_size_++] = b;
+    const auto size = expected_size(s.atr_bytes());
+    if (size == 0)
+      fail(id, s);
+    else if (size == s.atr_size_)
+      atr_complete(id, s, now);
+    else
+      arm(id, s, now + atr_character_wait_);
+    break;
+  }
+  case session_state::negotiating: {
+    if (s.pps_size_ == s.pps_.size())
+      return fail(id, s);
+    s.pps_[s.pps_size_++] = b;
+    const auto size = pps::expected_size(
+        gsl::span<const std::byte>(s.pps_).first(s.pps_size_));
+    if (size == 0)
+      fail(id, s);
+    else if (size == s.pps_size_)
+      pps_complete(id, s);
+    else
+      arm(id, s, now + s.wt_);
+    break;
+  }
+  default:
+    // bytes of an established session belong to the transport protocol
+    break;
+  }
+}
+
+void session_pool::atr_complete(std::size_t id, session &s,
+                                clock::time_point now) {
+  try {
+    const atr_view atr(s.atr_bytes());
+
+    // ISO7816-3:2006, 6.3.1 Selection of transmission parameters and
+    // protocol
+    if (atr.specific_mode()) {
+      const auto T = atr.specific_mode_T();
+      s.pps_availability_ = pps::available(atr, T);
+      if (atr.implicit_divider())
+        return establish(id, s, T, Fd, Dd);
+      return establish(id, s, T, atr.Fi(), atr.Di());
+    }
+
+    const auto T = select_protocol(atr);
+    if (T)
+      s.pps_availability_ = pps::available(atr, *T);
+    const auto request = T ? pps::propose(atr, *T) : std::nullopt;
+    if (!request)
+      return fail(id, s);
+
+    const auto TD1 = atr.intf_char(if_char::D, 1).value_or(0_b);
+    if (!request->PPS1 && std::to_integer<int>(TD1 & 0x0f_b) == *T)
+      return establish(id, s, *T, Fd, Dd);
+
+    std::array<std::byte, pps::max_size> buffer;
+    const auto encoded = pps::encode(*request, buffer);
+    s.request_ = *request;
+    s.state_ = session_state::negotiating;
+    s.wt_ = to_clock(atr.wt(freq_));
+    arm(id, s, now + s.wt_);
+    send_(id, encoded);
+  } catch (const invalid_atr &) {
+    fail(id, s);
+  }
+}
+
+void session_pool::pps_complete(std::size_t id, session &s) {
+  const auto result = pps::validate(
+      s.request_, gsl::span<const std::byte>(s.pps_).first(s.pps_size_));
+  if (!result)
+    return fail(id, s);
+  establish(id, s, result->T, result->F, result->D);
+}
+
+void session_pool::establish(std::size_t id, session &s, int T, int F, int D) {
+  if (T != 0 && T != 1)
+    return fail(id, s);
+  s.state_ = session_state::established;
+  s.protocol_ = T == 0 ? protocol_state::T0 : protocol_state::T1;
+  s.F_ = static_cast<std::uint16_t>(F);
+  s.D_ = static_cast<std::uint8_t>(D);
+  on_change_(id, s);
+}
+
+void session_pool::fail(std::size_t id, session &s) {
+  s.state_ = session_state::failed;
+  on_change_(id, s);
+}
+
+void session_pool::arm(std::size_t id, session &s,
+                       clock::time_point deadline) {
+  s.deadline_ = deadline;
+  // a queued timer that expires earlier is re-armed by advance()
+  if (s.timer_queued_ && s.queued_ <= deadline)
+    return;
+
+  s.timer_queued_ = true;
+  s.queued_ = deadline;
+  timers_.push_back({deadline, id});
+  std::push_heap(timers_.begin(), timers_.end(), expires_later);
+}
+
+} // namespace atr
@@ -0,0 +1,153 @@
+#include "t0.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "utility.hpp"
+
+namespace atr {
+namespace t0 {
+namespace {
+// ISO7816-3:2006, 10.3.3 Procedure bytes
+constexpr std::byte null_byte = 0x60_b;
+constexpr std::byte sw1_data_available = 0x61_b;
+constexpr std::byte sw1_wrong_length = 0x6C_b;
+constexpr std::byte ins_get_response = 0xC0_b;
+
+constexpr bool is_sw1(std::byte b) {
+  const auto high = b & 0xF0_b;
+  return b != null_byte && (high == 0x60_b || high == 0x90_b);
+}
+
+// P3 = 00 requests 256 bytes from the card
+constexpr std::size_t length(std::byte P3) {
+  return P3 == 0_b ? 256 : std::to_integer<std::size_t>(P3);
+}
+
+atr::duration steady_now() {
+  return std::chrono::steady_clock::now().time_since_epoch();
+}
+} // namespace
+
+transport::transport(const atr_view &atr, int F, int D, int freq,
+                     send_function send, recv_function recv,
+                     clock_function clock)
+    : send_(std::move(send)), recv_(std::move(recv)),
+      clock_(clock ? std::move(clock) : steady_now), wt_(atr.wt(freq)),
+      gt_(atr.gt(F, D, freq)) {}
+
+gsl::span<std::byte> transport::transceive(gsl::span<const std::byte> apdu,
+                                           gsl::span<std::byte> response) {
+  // ISO7816-3:2006, 12.1.3 Decoding conventions for command APDUs, only
+  // short APDUs can be mapped to TPDUs
+  if (apdu.size() < 4)
+    throw std::invalid_argument("APDU too short");
+  std::size_t Lc = 0;
+  std::size_t Le = 0;
+  if (apdu.size() == 5) {
+    Le = length(apdu[4]);
+  } else if (apdu.size() > 5) {
+    Lc = std::to_integer<std::size_t>(apdu[4]);
+    if (Lc == 0 || (apdu.size() != 5 + Lc && apdu.size() != 6 + Lc))
+      throw std::invalid_argument("APDU is not a short APDU");
+    if (apdu.size() == 6 + Lc)
+      Le = length(apdu.back());
+  }
+  if (response.size() < 2)
+    throw protocol_error("response buffer too small");
+  const auto data = response.first(response.size() - 2);
+
+  status s;
+  if (Lc != 0) {
+    s = exchange(apdu.first(5), apdu.subspan(5, Lc), {});
+  } else if (Le != 0) {
+    s = exchange_in(apdu.first(5), data);
+  } else {
+    std::copy_n(apdu.begin(), 4, header_.begin());
+    header_[4] = 0_b;
+    s = exchange(header_, {}, {});
+  }
+
+  // response data of case 2 & 4 is fetched while the card indicates more
+  std::size_t received = s.received;
+  while (s.sw1 == sw1_data_available && received < Le) {
+    const auto available = length(s.sw2);
+    header_ = {apdu[0], ins_get_response, 0_b, 0_b,
+               static_cast<std::byte>(std::min(available, Le - received))};
+    s = exchange_in(header_, data.subspan(received));
+    received += s.received;
+  }
+
+  response[received] = s.sw1;
+  response[received + 1] = s.sw2;
+  return response.first(received + 2);
+}
+
+transport::status transport::exchange(gsl::span<const std::byte> header,
+                                      gsl::span<const std::byte> command,
+                                      gsl::span<std::byte> response) {
+  send(header);
+  const auto ins = header[1];
+  const auto size = command.empty() ? response.size() : command.size();
+  std::size_t done = 0;
+  std::array<std::byte, 1> procedure;
+  while (true) {
+    receive(procedure);
+    const auto b = procedure[0];
+    if (b == null_byte)
+      continue;
+    if (is_sw1(b)) {
+      receive(procedure);
+      return {b, procedure[0], command.empty() ? done : 0};
+    }
+
+    // ACK: INS for all remaining data, INS ^ FF for the next byte only
+    std::size_t n;
+    if (b == ins)
+      n = size - done;
+    else if (b == ~ins)
+      n = std::min<std::size_t>(size - done, 1);
+    else
+      throw protocol_error("invalid procedure byte");
+    if (n == 0)
+      throw protocol_error("ACK without remaining data");
+
+    if (command.empty())
+      receive(response.subspan(done, n));
+    else
+      send(command.subspan(done, n));
+    done += n;
+  }
+}
+
+transport::status transport::exchange_in(gsl::span<const std::byte> header,
+                                         gsl::span<std::byte> response) {
+  auto size = length(header[4]);
+  if (size > response.size())
+    throw protocol_error("response buffer too small");
+  const auto s = exchange(header, {}, response.first(size));
+  if (s.sw1 != sw1_wrong_length || s.received != 0)
+    return s;
+
+  // the card states the correct length, the command is sent once more
+  size = length(s.sw2);
+  if (size > response.size())
+    throw protocol_error("response buffer too small");
+  std::copy_n(header.begin(), 4, header_.begin());
+  header_[4] = s.sw2;
+  return exchange(header_, {}, response.first(size));
+}
+
+void transport::send(gsl::span<const std::byte> data) {
+  if (!send_(data))
+    throw protocol_error("sending failed");
+}
+
+void transport::receive(gsl::span<std::byte> buffer) {
+  const auto start = clock_();
+  if (!recv_(buffer, wt_) || clock_() - start > wt_ * buffer.size())
+    throw protocol_error("no character received within WT");
+}
+
+} // namespace t0
+} // namespace atr
@@ -0,0 +1,245 @@
+#include "t1.hpp"
+
+#include <algorithm>
+
+#include "edc.hpp"
+#include "utility.hpp"
+
+namespace atr {
+namespace t1 {
+namespace {
+// ISO7816-3:2006, 11.3 Block frame
+constexpr std::size_t max_inf_size = 254;
+constexpr int max_errors = 3;
+
+constexpr std::byte pcb_R = 0x80_b;
+constexpr std::byte pcb_S = 0xC0_b;
+constexpr std::byte pcb_type_mask = 0xC0_b;
+constexpr std::byte pcb_I_ns = 0x40_b;
+constexpr std::byte pcb_I_more = 0x20_b;
+constexpr std::byte pcb_R_nr = 0x10_b;
+constexpr std::byte pcb_R_edc_error = 0x01_b;
+constexpr std::byte pcb_R_other_error = 0x02_b;
+constexpr std::byte pcb_S_response = 0x20_b;
+constexpr std::byte pcb_S_type_mask = 0x1F_b;
+
+enum class s_type { resynch = 0, ifs = 1, abort = 2, wtx = 3 };
+
+constexpr bool is_I(std::byte pcb) { return (pcb & 0x80_b) == 0_b; }
+constexpr bool is_R(std::byte pcb) { return (pcb & pcb_type_mask) == pcb_R; }
+constexpr bool is_S(std::byte pcb) { return (pcb & pcb_type_mask) == pcb_S; }
+
+constexpr std::byte I_block(bool ns, bool more) {
+  return (ns ? pcb_I_ns : 0_b) | (more ? pcb_I_more : 0_b);
+}
+constexpr std::byte R_block(bool nr, std::byte error = 0_b) {
+  return pcb_R | (nr ? pcb_R_nr : 0_b) | error;
+}
+constexpr std::byte S_block(s_type type, bool response = false) {
+  return pcb_S | (response ? pcb_S_response : 0_b) |
+         static_cast<std::byte>(type);
+}
+
+// writes the epilogue field for prologue + inf to the start of out
+gsl::span<std::byte> epilogue(redundancy_code code,
+                              gsl::span<const std::byte> prologue,
+                              gsl::span<const std::byte> inf,
+                              gsl::span<std::byte> out) {
+  return edc(code).update(prologue).update(inf).write(out);
+}
+} // namespace
+
+transport::transport(const atr_view &atr, int F, int D, int freq,
+                     send_function send, recv_function recv, std::byte nad)
+    : send_(std::move(send)), recv_(std::move(recv)), nad_(nad),
+      code_(atr.code()), ifsc_(atr.ifsc()), bwt_(atr.bwt(F, D, freq)),
+      cwt_(atr.cwt(F, D, freq)) {}
+
+gsl::span<std::byte> transport::transceive(gsl::span<const std::byte> apdu,
+                                           gsl::span<std::byte> response) {
+  std::size_t received = 0;
+  gsl::span<const std::byte> chunk;
+  bool more = false;
+  bool sending = true;
+  int errors = 0;
+
+  // chaining: the APDU is split into I-blocks of at most IFSC bytes
+  auto send_chunk = [&]() {
+    chunk = apdu.first(std::min(apdu.size(), ifsc_));
+    more = chunk.size() < apdu.size();
+    send_block(I_block(ns_, more), chunk);
+  };
+
+  send_chunk();
+  while (true) {
+    const auto blk = receive_block(response.subspan(received));
+    if (!blk) {
+      handle_error(errors, pcb_R_edc_error);
+      continue;
+    }
+    const auto pcb = blk->pcb;
+
+    if (is_S(pcb)) {
+      if ((pcb & pcb_S_response) != 0_b || blk->inf.size() > 1) {
+        handle_error(errors, pcb_R_other_error);
+        continue;
+      }
+      const auto type = std::to_integer<int>(pcb & pcb_S_type_mask);
+      switch (static_cast<s_type>(type)) {
+      case s_type::wtx:
+        if (blk->inf.size() != 1 || blk->inf[0] == 0_b) {
+          handle_error(errors, pcb_R_other_error);
+          continue;
+        }
+        wtx_ = std::to_integer<int>(blk->inf[0]);
+        break;
+      case s_type::ifs:
+        if (blk->inf.size() != 1 || blk->inf[0] == 0_b ||
+            blk->inf[0] == 0xFF_b) {
+          handle_error(errors, pcb_R_other_error);
+          continue;
+        }
+        ifsc_ = std::to_integer<std::size_t>(blk->inf[0]);
+        break;
+      case s_type::abort:
+        throw protocol_error("chain aborted by card");
+      default:
+        handle_error(errors, pcb_R_other_error);
+        continue;
+      }
+      s_inf_[0] = blk->inf[0];
+      send_block(pcb | pcb_S_response, s_inf_);
+      continue;
+    }
+
+    if (is_R(pcb)) {
+      const bool nr = (pcb & pcb_R_nr) != 0_b;
+      if (sending && more && nr != ns_) {
+        // acknowledgement of a chained I-block
+        ns_ = !ns_;
+        apdu = apdu.subspan(chunk.size());
+        errors = 0;
+        send_chunk();
+      } else {
+        if (++errors > max_errors)
+          throw protocol_error("too many retransmissions");
+        // ISO7816-3:2006, 11.6.3.2: N(R) of our unacknowledged
+        // I-block requests it again, even after R-blocks of our own.
+        // Otherwise the card did not get our last R- or S-block.
+        if (sending && nr == ns_)
+          send_block(last_i_pcb_, last_i_inf_);
+        else
+          resend_block();
+      }
+      continue;
+    }
+
+    const bool ns = (pcb & pcb_I_ns) != 0_b;
+    if ((sending && more) || ns != nr_) {
+      handle_error(errors, pcb_R_other_error);
+      continue;
+    }
+    if (sending) {
+      // response implicitly acknowledges our last I-block
+      ns_ = !ns_;
+      sending = false;
+    }
+    received += blk->inf.size();
+    nr_ = !nr_;
+    errors = 0;
+
+    if ((pcb & pcb_I_more) == 0_b)
+      return response.first(received);
+    send_block(R_block(nr_), {});
+  }
+}
+
+void transport::negotiate_ifsd(std::size_t ifsd) {
+  if (ifsd == 0 || ifsd > max_inf_size)
+    throw std::invalid_argument("IFSD out of range");
+
+  s_inf_[0] = static_cast<std::byte>(ifsd);
+  send_block(S_block(s_type::ifs), s_inf_);
+  int errors = 0;
+  while (true) {
+    const auto blk = receive_block({});
+    if (blk && blk->pcb == S_block(s_type::ifs, true) &&
+        blk->inf.size() == 1 && blk->inf[0] == s_inf_[0]) {
+      ifsd_ = ifsd;
+      return;
+    }
+    if (++errors > max_errors)
+      throw protocol_error("IFSD negotiation failed");
+    resend_block();
+  }
+}
+
+void transport::send_block(std::byte pcb, gsl::span<const std::byte> inf) {
+  const std::array<std::byte, 3> prologue{nad_, pcb,
+                                          static_cast<std::byte>(inf.size())};
+  std::array<std::byte, edc::max_size> buffer;
+  const auto epilogue_field = epilogue(code_, prologue, inf, buffer);
+
+  if (!send_(prologue) || (!inf.empty() && !send_(inf)) ||
+      !send_(epilogue_field))
+    throw protocol_error("sending block failed");
+
+  last_pcb_ = pcb;
+  last_inf_ = inf;
+  if (is_I(pcb)) {
+    last_i_pcb_ = pcb;
+    last_i_inf_ = inf;
+  }
+}
+
+void transport::resend_block() { send_block(last_pcb_, last_inf_); }
+
+std::optional<transport::block>
+transport::receive_block(gsl::span<std::byte> i_inf) {
+  std::array<std::byte, 3> prologue;
+  const auto bwt = bwt_ * wtx_;
+  wtx_ = 1;
+  if (!recv_(prologue, bwt))
+    throw protocol_error("no block received within BWT");
+
+  const auto pcb = prologue[1];
+  const auto len = std::to_integer<std::size_t>(prologue[2]);
+  gsl::span<std::byte> inf;
+  std::array<std::byte, max_inf_size> discard;
+  bool valid = prologue[0] == nad_ && len <= max_inf_size;
+  if (is_I(pcb) && len <= ifsd_ && len > i_inf.size())
+    throw protocol_error("response buffer too small");
+  if (is_I(pcb) && len <= ifsd_)
+    inf = i_inf.first(len);
+  else if (is_S(pcb) && len <= s_rx_.size())
+    inf = gsl::span<std::byte>(s_rx_).first(len);
+  else if (is_R(pcb) && len == 0)
+    inf = {};
+  else
+    valid = false;
+
+  // still receive the whole block to resynchronize with the card
+  if (!valid)
+    inf = gsl::span<std::byte>(discard).first(std::min(len, max_inf_size));
+
+  std::array<std::byte, edc::max_size> buffer;
+  const auto received = gsl::span<std::byte>(buffer).first(edc(code_).size());
+  if ((!inf.empty() && !recv_(inf, cwt_)) || !recv_(received, cwt_))
+    throw protocol_error("incomplete block received");
+
+  std::array<std::byte, edc::max_size> expected_buffer;
+  const auto expected = epilogue(code_, prologue, inf, expected_buffer);
+  if (!valid || !std::equal(received.begin(), received.end(),
+                            expected.begin(), expected.end()))
+    return {};
+  return block{pcb, inf};
+}
+
+void transport::handle_error(int &errors, std::byte error) {
+  if (++errors > max_errors)
+    throw protocol_error("too many transmission errors");
+  send_block(R_block(nr_, error), {});
+}
+
+} // namespace t1
+} // namespace atr
@@ -20,6 +20,16 @@ constexpr int popcount(std::byte b) noexcept {
          std::to_integer<int>((b >> 7) & 1_b);
 }
 
+// ISO7816-3:2006, 8.3 Global interface bytes, Table 7 & 8
+constexpr int Fi_lookup[] = {372, 372, 558, 744,  1116, 1488, 1860, 0,
+                             0,   512, 768, 1024, 1536, 2048, 0,    0};
+constexpr int FMax_lookup[] = {4'000'000,  5'000'000,  6'000'000,  8'000'000,
+                               12'000'000, 16'000'000, 20'000'000, 0,
+                               0,          5'000'000,  7'500'000,  10'000'000,
+                               15'000'000, 20'000'000, 0,          0};
+constexpr int Di_lookup[] = {0, 1, 2, 4, 8, 16, 32, 64,
+                             12, 20, 0, 0, 0, 0, 0, 0};
+
 } // namespace atr
 
 #endif
\ No newline at end of file
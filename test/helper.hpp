@@ -2,14 +2,15 @@
 #define header_test_helper_
 
 #include <cstddef>
+#include <memory_resource>
 #include <vector>
 
-static std::vector<std::byte> operator""_h2b(const char *chars,
-                                             std::size_t size) {
+static std::pmr::vector<std::byte> operator""_h2b(const char *chars,
+                                                  std::size_t size) {
   auto str = std::string_view(chars, size);
 
   constexpr char space[] = {' ', '\t', '\r', '\n'};
-  std::vector<std::byte> result;
+  std::pmr::vector<std::byte> result;
   bool first = true;
   std::byte b;
 
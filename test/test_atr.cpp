@@ -153,30 +153,31 @@ TEST_CASE("TA2") {
     REQUIRE(atr.implicit_divider() == false);
   }
   SECTION("all off") {
+    // b8 = 0: capable to change the mode
     atr::atr atr("3B80 10 00"_h2b);
     REQUIRE(atr.specific_mode() == true);
-    REQUIRE(atr.specific_change_capable() == false);
+    REQUIRE(atr.specific_change_capable() == true);
     REQUIRE(atr.implicit_divider() == false);
     REQUIRE(atr.specific_mode_T() == 0);
   }
-  SECTION("w specific mode changable") {
+  SECTION("w/o specific mode change") {
     atr::atr atr("3B80 10 80"_h2b);
     REQUIRE(atr.specific_mode() == true);
-    REQUIRE(atr.specific_change_capable() == true);
+    REQUIRE(atr.specific_change_capable() == false);
     REQUIRE(atr.implicit_divider() == false);
     REQUIRE(atr.specific_mode_T() == 0);
   }
   SECTION("w implicit divider") {
     atr::atr atr("3B80 10 10"_h2b);
     REQUIRE(atr.specific_mode() == true);
-    REQUIRE(atr.specific_change_capable() == false);
+    REQUIRE(atr.specific_change_capable() == true);
     REQUIRE(atr.implicit_divider() == true);
     REQUIRE(atr.specific_mode_T() == 0);
   }
   SECTION("T=1 specific mode") {
     atr::atr atr("3B80 10 01"_h2b);
     REQUIRE(atr.specific_mode() == true);
-    REQUIRE(atr.specific_change_capable() == false);
+    REQUIRE(atr.specific_change_capable() == true);
     REQUIRE(atr.implicit_divider() == false);
     REQUIRE(atr.specific_mode_T() == 1);
   }
@@ -374,6 +375,271 @@ TEST_CASE("TCK") {
   }
 }
 
+TEST_CASE("EMV profile") {
+  SECTION("basic T=0") {
+    atr::atr atr("3B60 0000"_h2b, atr::profile::EMV);
+    REQUIRE(atr.emv_compliant());
+  }
+  SECTION("basic T=1") {
+    atr::atr atr("3BE0 000081 31 FE45 EB"_h2b, atr::profile::EMV);
+    REQUIRE(atr.emv_compliant());
+    REQUIRE(atr.ifsc() == 0xFE);
+    REQUIRE(atr.code() == atr::redundancy_code::LRC);
+  }
+  SECTION("ISO valid, not EMV compliant") {
+    auto bytes = GENERATE("3B00"_h2b,                     // TB1 absent
+                          "3B60 0100"_h2b,                // TB1 != 00
+                          "3BF0 18000081 31 FE45 E3"_h2b, // TA1 out of range
+                          "3BE0 000081 71 FE4501 AA"_h2b, // CRC for T=1
+                          "3BE0 000081 31 FE46 E8"_h2b,   // CWI too big
+                          "3BE0 000081 11 FE 8E"_h2b,     // TB3 absent
+                          "3BE0 000040 0B"_h2b            // TC2 != 0A
+    );
+    CAPTURE(bytes);
+    atr::atr atr(bytes);
+    REQUIRE(!atr.emv_compliant());
+    REQUIRE_THROWS(atr::atr(bytes, atr::profile::EMV));
+  }
+  SECTION("defaults") {
+    const auto bytes = "3B60 0000"_h2b;
+    atr::atr emv(bytes, atr::profile::EMV);
+    atr::atr iso(bytes);
+    REQUIRE(emv.Fi() == 372);
+    REQUIRE(emv.Di() == 1);
+    REQUIRE(emv.N() == 0);
+    REQUIRE(emv.wt(5'000'000) == iso.wt(5'000'000));
+    REQUIRE(emv.wt(5'000'000).count() == 10.0 * 960 * 372 / 5'000'000);
+    REQUIRE(emv.gt(372, 1, 5'000'000) == iso.gt(372, 1, 5'000'000));
+  }
+  SECTION("ISO invalid") {
+    REQUIRE_THROWS(atr::atr("3B70 710000"_h2b, atr::profile::EMV));
+  }
+}
+
+TEST_CASE("view") {
+  const auto bytes =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  const atr::atr_view view(bytes);
+  REQUIRE(view.bytes().data() == bytes.data());
+  REQUIRE(view.historical_bytes().data() == bytes.data() + 10);
+  REQUIRE(view.historical_bytes().size() == 15);
+  REQUIRE(view.intf_char(atr::if_char::B, 1) == std::byte{0xBB});
+  REQUIRE(view.first(atr::if_char::A, 1) == std::byte{0xEF});
+  REQUIRE(view.ifsc() == 0xEF);
+  REQUIRE(view.Fi() == 372);
+
+  SECTION("invalid") {
+    const auto invalid = "3B10 00"_h2b;
+    REQUIRE_THROWS_AS(atr::atr_view(invalid), atr::invalid_atr);
+  }
+  SECTION("to atr") {
+    const atr::atr atr(view);
+    REQUIRE(atr.bytes() == bytes);
+    REQUIRE(atr.bytes().data() != bytes.data());
+    REQUIRE(atr.historical_bytes() == "151413121110090807060504030201"_h2b);
+    REQUIRE(atr.ifsc() == 0xEF);
+  }
+  SECTION("from atr") {
+    auto atr = std::make_unique<atr::atr>(bytes);
+    const atr::atr_view sliced = *atr;
+    REQUIRE(sliced.bytes().data() == atr->bytes().data());
+
+    // copies view their own bytes
+    const atr::atr copy = *atr;
+    atr.reset();
+    const atr::atr_view of_copy = copy;
+    REQUIRE(of_copy.bytes().data() == copy.bytes().data());
+    REQUIRE(of_copy.first(atr::if_char::A, 1) == std::byte{0xEF});
+  }
+  SECTION("moved from atr") {
+    atr::atr from(bytes);
+    const atr::atr to = std::move(from);
+    REQUIRE(to.bytes() == bytes);
+    const atr::atr_view &moved = from;
+    REQUIRE(from.bytes().empty());
+    REQUIRE(moved.bytes().empty());
+    REQUIRE(moved.historical_bytes().empty());
+    REQUIRE(!moved.T_present(1));
+
+    from = atr::atr("3B00"_h2b);
+    atr::atr other = std::move(from);
+    REQUIRE(moved.bytes().empty());
+    REQUIRE(other.bytes() == "3B00"_h2b);
+  }
+  // the view of an atr can only change together with its bytes
+  static_assert(!std::is_assignable_v<atr::atr_view &, const atr::atr_view &>);
+}
+
+TEST_CASE("parse without exceptions") {
+  std::error_code ec = atr::rule::structure;
+  const auto bytes = "3B80 80 1F 41 5E"_h2b;
+  const auto view = atr::atr_view::parse(bytes, ec);
+  REQUIRE(view);
+  REQUIRE(!ec);
+  REQUIRE(view->bytes().data() == bytes.data());
+  REQUIRE(view->ifsc() == 32);
+
+  REQUIRE(!atr::atr_view::parse("3B80 80 11 00 11"_h2b, ec));
+  REQUIRE(ec == atr::rule::invalid_ifsc);
+  REQUIRE(ec.category() == atr::atr_category());
+  REQUIRE(std::string_view(ec.category().name()) == "atr");
+  REQUIRE(ec.message() == atr::message(atr::rule::invalid_ifsc));
+
+  // EMV violations are only errors for the EMV profile
+  REQUIRE(atr::atr_view::parse("3B00"_h2b, ec));
+  REQUIRE(!ec);
+  REQUIRE(!atr::atr_view::parse("3B00"_h2b, ec, atr::profile::EMV));
+  REQUIRE(ec == atr::rule::emv_TB1_absent);
+  // the first violation is reported, even if it is an EMV one
+  REQUIRE(!atr::atr_view::parse("3C10 00"_h2b, ec, atr::profile::EMV));
+  REQUIRE(ec == atr::rule::emv_TS);
+}
+
+TEST_CASE("allocator") {
+  const auto bytes =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  // fails on any allocation beyond the arena
+  std::array<std::byte, 256> memory;
+  std::pmr::monotonic_buffer_resource arena(memory.data(), memory.size(),
+                                            std::pmr::null_memory_resource());
+
+  SECTION("from span") {
+    atr::atr atr(gsl::span<const std::byte>(bytes), atr::profile::ISO7816,
+                 &arena);
+    REQUIRE(atr.get_allocator().resource() == &arena);
+    REQUIRE(atr.historical_bytes() == "151413121110090807060504030201"_h2b);
+  }
+  SECTION("from vector") {
+    atr::atr atr(std::pmr::vector<std::byte>(bytes, &arena));
+    REQUIRE(atr.historical_bytes().get_allocator().resource() == &arena);
+  }
+  SECTION("in a container") {
+    std::pmr::vector<atr::atr> atrs(&arena);
+    atrs.reserve(1);
+    atrs.emplace_back("3B02 1122"_h2b);
+    REQUIRE(atrs[0].get_allocator().resource() == &arena);
+    REQUIRE(atrs[0].historical_bytes() == "1122"_h2b);
+  }
+}
+
+namespace {
+// F/D of TA1 values and common reader clocks
+struct sweep_points {
+  std::vector<int> F;
+  std::vector<int> D;
+  std::vector<int> freq;
+
+  sweep_points() {
+    for (const int f : {1'000'000, 3'579'545, 4'000'000, 5'000'000, 8'000'000})
+      for (const int F_ : {372, 512, 558, 744, 1116, 2048})
+        for (const int D_ : {1, 2, 4, 8, 16, 32}) {
+          F.push_back(F_);
+          D.push_back(D_);
+          freq.push_back(f);
+        }
+  }
+  std::size_t size() const { return F.size(); }
+};
+} // namespace
+
+TEST_CASE("timing sweep") {
+  const sweep_points points;
+  const auto n = points.size();
+  std::vector<atr::atr_view::duration> gt(n), wt(n), cwt(n), bwt(n);
+
+  const auto t1 =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  const auto all =
+      "3bff 34ffafe0 ff20F1 ef23011f 87 112233445566778899aabbccddeeff 00"_h2b;
+  for (const auto &bytes : {"3B00"_h2b, "3B40 20"_h2b, t1, all}) {
+    const atr::atr_view view(bytes);
+    view.sweep(points.F, points.D, points.freq, {gt, wt, cwt, bwt});
+    for (std::size_t i = 0; i < n; i++) {
+      const auto F = points.F[i];
+      const auto D = points.D[i];
+      const auto f = points.freq[i];
+      REQUIRE_THAT(gt[i].count(), WithinRel(view.gt(F, D, f).count()));
+      REQUIRE_THAT(wt[i].count(), WithinRel(view.wt(f).count()));
+      REQUIRE_THAT(cwt[i].count(), WithinRel(view.cwt(F, D, f).count()));
+      REQUIRE_THAT(bwt[i].count(), WithinRel(view.bwt(F, D, f).count()));
+    }
+  }
+
+  SECTION("only requested outputs are written") {
+    std::fill(gt.begin(), gt.end(), atr::atr_view::duration{-1});
+    const auto bytes = "3B00"_h2b;
+    const atr::atr_view view(bytes);
+    view.sweep(points.F, points.D, points.freq, {{}, wt, {}, {}});
+    REQUIRE(gt.front().count() == -1);
+    REQUIRE(wt.front() == view.wt(points.freq.front()));
+  }
+  SECTION("sizes differ") {
+    std::fill(wt.begin(), wt.end(), atr::atr_view::duration{-1});
+    std::fill(cwt.begin(), cwt.end(), atr::atr_view::duration{-1});
+    const auto bytes = "3B00"_h2b;
+    const atr::atr_view view(bytes);
+    const gsl::span<const int> D(points.D);
+    view.sweep(points.F, D.first(3), points.freq,
+               {{}, gsl::span<atr::atr_view::duration>(wt).first(5), cwt, {}});
+    REQUIRE(wt[2] == view.wt(points.freq[2]));
+    REQUIRE(wt[3].count() == -1);
+    REQUIRE(cwt[3].count() == -1);
+    wt[0] = atr::atr_view::duration{-1};
+    view.sweep({}, points.D, points.freq, {{}, wt, {}, {}});
+    REQUIRE(wt[0].count() == -1);
+  }
+}
+
+TEST_CASE("sweep", "[!benchmark]") {
+  const sweep_points points;
+  const auto n = points.size();
+  std::vector<atr::atr_view::duration> gt(n), wt(n), cwt(n), bwt(n);
+  const auto bytes =
+      "3bff 34ffafe0 ff20F1 ef23011f 87 112233445566778899aabbccddeeff 00"_h2b;
+  const atr::atr_view view(bytes);
+
+  BENCHMARK("accessors per point") {
+    for (std::size_t i = 0; i < n; i++) {
+      const auto F = points.F[i];
+      const auto D = points.D[i];
+      const auto f = points.freq[i];
+      gt[i] = view.gt(F, D, f);
+      wt[i] = view.wt(f);
+      cwt[i] = view.cwt(F, D, f);
+      bwt[i] = view.bwt(F, D, f);
+    }
+    return bwt.back();
+  };
+  BENCHMARK("sweep") {
+    view.sweep(points.F, points.D, points.freq, {gt, wt, cwt, bwt});
+    return bwt.back();
+  };
+}
+
+TEST_CASE("parse", "[!benchmark]") {
+  const auto minimal = "3B00"_h2b;
+  const auto t1 =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  const auto all =
+      "3bff 34ffafe0 ff20F1 ef23011f 87 112233445566778899aabbccddeeff 00"_h2b;
+
+  BENCHMARK("minimal") { return atr::atr(minimal); };
+  BENCHMARK("max T=1") { return atr::atr(t1); };
+  BENCHMARK("all settings") { return atr::atr(all); };
+  BENCHMARK("all settings, EMV verdict") {
+    return atr::atr(all).emv_compliant();
+  };
+  BENCHMARK("all settings, view") { return atr::atr_view(all).Fi(); };
+
+  std::array<std::byte, 1024> memory;
+  BENCHMARK("all settings, arena") {
+    std::pmr::monotonic_buffer_resource arena(memory.data(), memory.size());
+    return atr::atr(gsl::span<const std::byte>(all), atr::profile::ISO7816,
+                    &arena)
+        .Fi();
+  };
+}
+
 #include <gsl/span>
 #include <iomanip>
 #include <ios>
@@ -0,0 +1,125 @@
+#include "dispatch.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+// polls until count completions arrived
+std::vector<atr::dispatcher::completion> collect(atr::dispatcher &d,
+                                                 std::size_t count) {
+  std::vector<atr::dispatcher::completion> completions;
+  while (completions.size() < count) {
+    if (auto c = d.poll())
+      completions.push_back(std::move(*c));
+    else
+      std::this_thread::yield();
+  }
+  return completions;
+}
+} // namespace
+
+TEST_CASE("dispatcher") {
+  const auto workers = GENERATE(1, 3);
+  atr::dispatcher dispatcher(4, workers);
+  REQUIRE(dispatcher.workers() == static_cast<std::size_t>(workers));
+
+  SECTION("valid and invalid ATRs") {
+    REQUIRE(dispatcher.submit(0, "3B02 1122"_h2b));
+    REQUIRE(dispatcher.submit(2, "3B10 00"_h2b));
+    const auto completions = collect(dispatcher, 2);
+    REQUIRE_FALSE(dispatcher.poll());
+
+    for (const auto &c : completions) {
+      REQUIRE(c.sequence == 0);
+      if (c.reader == 0) {
+        REQUIRE(c.result);
+        REQUIRE(c.result->historical_bytes() == "1122"_h2b);
+        REQUIRE(c.error.empty());
+      } else {
+        REQUIRE(c.reader == 2);
+        REQUIRE_FALSE(c.result);
+        REQUIRE_FALSE(c.error.empty());
+      }
+    }
+  }
+  SECTION("sequence per reader") {
+    const std::size_t count = 1000;
+    std::vector<std::uint64_t> expected(dispatcher.readers());
+    std::size_t submitted = 0;
+    std::vector<atr::dispatcher::completion> completions;
+    while (submitted < count || completions.size() < count) {
+      if (submitted < count &&
+          dispatcher.submit(submitted % dispatcher.readers(), "3b00"_h2b))
+        submitted++;
+      while (auto c = dispatcher.poll())
+        completions.push_back(std::move(*c));
+    }
+
+    std::vector<std::vector<bool>> seen(dispatcher.readers(),
+                                        std::vector<bool>(count, false));
+    for (const auto &c : completions) {
+      REQUIRE(c.result);
+      REQUIRE_FALSE(seen[c.reader][c.sequence]);
+      seen[c.reader][c.sequence] = true;
+    }
+    for (std::size_t r = 0; r < dispatcher.readers(); r++)
+      for (std::size_t i = 0; i < count / dispatcher.readers(); i++)
+        REQUIRE(seen[r][i]);
+  }
+  SECTION("full ring") {
+    atr::dispatcher stopped(1, 1, atr::profile::ISO7816, 4);
+    std::size_t accepted = 0;
+    while (stopped.submit(0, "3b00"_h2b))
+      accepted++;
+    REQUIRE(accepted >= 4);
+    collect(stopped, accepted);
+  }
+  SECTION("wake idle workers") {
+    for (int i = 0; i < 3; i++) {
+      // long enough for all workers to fall asleep
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      REQUIRE(dispatcher.submit(1, "3b00"_h2b));
+      REQUIRE(collect(dispatcher, 1).front().sequence ==
+              static_cast<std::uint64_t>(i));
+    }
+  }
+  SECTION("full completion queue") {
+    atr::dispatcher small(1, 1, atr::profile::ISO7816, 64, 2);
+    std::size_t accepted = 0;
+    while (accepted < 32)
+      if (small.submit(0, "3b00"_h2b))
+        accepted++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(collect(small, accepted).size() == accepted);
+  }
+  SECTION("too long") {
+    REQUIRE_FALSE(
+        dispatcher.submit(0, std::vector<std::byte>(atr::max_atr_size + 1)));
+  }
+}
+
+TEST_CASE("dispatch", "[!benchmark]") {
+  const auto workers = GENERATE(1, 2, 4, 8);
+  const auto atr =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  const std::size_t readers = 256;
+  const std::size_t count = 10'000;
+
+  atr::dispatcher dispatcher(readers, workers);
+  BENCHMARK("parse 10000 ATRs, " + std::to_string(workers) + " workers") {
+    std::size_t submitted = 0;
+    std::size_t completed = 0;
+    while (completed < count) {
+      while (submitted < count &&
+             dispatcher.submit(submitted % readers, atr))
+        submitted++;
+      while (dispatcher.poll())
+        completed++;
+    }
+    return completed;
+  };
+}
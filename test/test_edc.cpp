@@ -0,0 +1,106 @@
+#include "edc.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <numeric>
+#include <string_view>
+
+namespace {
+std::vector<std::byte> make_data(std::size_t size) {
+  std::vector<std::byte> data(size);
+  for (std::size_t i = 0; i < size; i++)
+    data[i] = static_cast<std::byte>(i * 131 + 7);
+  return data;
+}
+
+std::byte lrc_reference(gsl::span<const std::byte> data) {
+  return std::accumulate(data.begin(), data.end(), std::byte{0},
+                         [](std::byte a, std::byte b) { return a ^ b; });
+}
+
+std::uint16_t crc_reference(gsl::span<const std::byte> data) {
+  std::uint16_t value = 0xFFFF;
+  for (const auto b : data) {
+    value ^= std::to_integer<std::uint16_t>(b);
+    for (int i = 0; i < 8; i++)
+      value = (value & 1) ? (value >> 1) ^ 0x8408 : (value >> 1);
+  }
+  return value;
+}
+} // namespace
+
+TEST_CASE("LRC") {
+  REQUIRE(atr::lrc().value() == std::byte{0});
+  REQUIRE(atr::lrc().update("0040 00"_h2b).value() == std::byte{0x40});
+
+  const auto size = GENERATE(1, 7, 8, 9, 31, 254, 1000);
+  const auto data = make_data(size);
+  REQUIRE(atr::lrc().update(data).value() == lrc_reference(data));
+}
+
+TEST_CASE("CRC") {
+  SECTION("check value") {
+    constexpr std::string_view check = "123456789";
+    const auto data = gsl::as_bytes(gsl::span(check.data(), check.size()));
+    REQUIRE(atr::crc().update(data).value() == 0x6F91);
+  }
+  SECTION("matches bitwise reference") {
+    const auto size = GENERATE(1, 7, 8, 9, 31, 254, 1000);
+    const auto data = make_data(size);
+    REQUIRE(atr::crc().update(data).value() == crc_reference(data));
+  }
+}
+
+TEST_CASE("EDC streaming") {
+  const auto data = make_data(259);
+  const auto split = GENERATE(0, 1, 3, 8, 100, 259);
+  const auto span = gsl::span<const std::byte>(data);
+
+  atr::crc crc;
+  crc.update(span.first(split)).update(span.subspan(split));
+  REQUIRE(crc.value() == crc_reference(data));
+
+  atr::lrc lrc;
+  lrc.update(span.first(split)).update(span.subspan(split));
+  REQUIRE(lrc.value() == lrc_reference(data));
+}
+
+TEST_CASE("EDC selected by ATR") {
+  std::array<std::byte, atr::edc::max_size> buffer;
+  SECTION("LRC") {
+    atr::atr atr("3B80 80 41 00 41"_h2b);
+    atr::edc edc(atr.code());
+    REQUIRE(edc.size() == 1);
+    auto written = edc.update("0040 00"_h2b).write(buffer);
+    REQUIRE(std::pmr::vector<std::byte>(written.begin(), written.end()) ==
+            "40"_h2b);
+  }
+  SECTION("CRC") {
+    atr::atr atr("3B80 80 41 01 40"_h2b);
+    atr::edc edc(atr.code());
+    REQUIRE(edc.size() == 2);
+    const auto data = "0040 00"_h2b;
+    const auto expected = crc_reference(data);
+    auto written = edc.update(data).write(buffer);
+    REQUIRE(written.size() == 2);
+    REQUIRE(std::to_integer<int>(written[0]) == (expected >> 8));
+    REQUIRE(std::to_integer<int>(written[1]) == (expected & 0xff));
+  }
+}
+
+TEST_CASE("EDC", "[!benchmark]") {
+  const auto block = make_data(254 + 3);
+  const auto large = make_data(64 * 1024);
+
+  BENCHMARK("LRC reference, block") { return lrc_reference(block); };
+  BENCHMARK("LRC, block") { return atr::lrc().update(block).value(); };
+  BENCHMARK("CRC reference, block") { return crc_reference(block); };
+  BENCHMARK("CRC, block") { return atr::crc().update(block).value(); };
+
+  BENCHMARK("LRC reference, 64k") { return lrc_reference(large); };
+  BENCHMARK("LRC, 64k") { return atr::lrc().update(large).value(); };
+  BENCHMARK("CRC reference, 64k") { return crc_reference(large); };
+  BENCHMARK("CRC, 64k") { return atr::crc().update(large).value(); };
+}
@@ -0,0 +1,102 @@
+#include "format.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <array>
+#include <string_view>
+
+namespace {
+std::string_view to_view(gsl::span<const char> s) {
+  return std::string_view(s.data(), s.size());
+}
+} // namespace
+
+TEST_CASE("dump") {
+  std::array<char, 1024> buffer;
+
+  SECTION("minimal, text") {
+    const auto bytes = "3B00"_h2b;
+    const atr::atr_view atr(bytes);
+    REQUIRE(to_view(atr::dump(atr, buffer)) == "TS 3B direct\n"
+                                                "T0 00 K=0\n"
+                                                "T 0\n"
+                                                "Fi 372\n"
+                                                "Di 1\n"
+                                                "FMax 5000000\n"
+                                                "freq 5000000\n"
+                                                "GT_ns 892800\n"
+                                                "WT_ns 714240000\n"
+                                                "clockstop not_supported\n"
+                                                "classes A\n"
+                                                "historical ");
+  }
+  SECTION("minimal, JSON") {
+    const auto bytes = "3B00"_h2b;
+    const atr::atr_view atr(bytes);
+    REQUIRE(to_view(atr::dump(atr, buffer, atr::dump_format::json)) ==
+            "{\"TS\":\"3B direct\",\"T0\":\"00 K=0\",\"T\":[0],\"Fi\":372,"
+            "\"Di\":1,\"FMax\":5000000,\"freq\":5000000,\"GT_ns\":892800,"
+            "\"WT_ns\":714240000,\"clockstop\":\"not_supported\","
+            "\"classes\":\"A\",\"historical\":\"\"}");
+  }
+  SECTION("T=1 and T=15") {
+    const auto bytes = "3bff 34ffafe0 ff20F1 ef23011f 87 "
+                       "112233445566778899aabbccddeeff 00"_h2b;
+    const atr::atr_view atr(bytes);
+    const auto text = to_view(atr::dump(atr, buffer));
+    CAPTURE(text);
+    REQUIRE(text.find("TA1 34 Fi=744 Di=8 FMax=8000000\n") !=
+            std::string_view::npos);
+    REQUIRE(text.find("TC1 AF N=175\n") != std::string_view::npos);
+    REQUIRE(text.find("TB2 FF PI2 (deprecated)\n") != std::string_view::npos);
+    REQUIRE(text.find("TC2 20 WI=32\n") != std::string_view::npos);
+    REQUIRE(text.find("TD2 F1 T=1\n") != std::string_view::npos);
+    REQUIRE(text.find("TA3 EF IFSC=239\n") != std::string_view::npos);
+    REQUIRE(text.find("TB3 23 BWI=2 CWI=3\n") != std::string_view::npos);
+    REQUIRE(text.find("TC3 01 CRC\n") != std::string_view::npos);
+    REQUIRE(text.find("TA4 87 clock stop high classes ABC\n") !=
+            std::string_view::npos);
+    REQUIRE(text.find("T 0 1 15\n") != std::string_view::npos);
+    REQUIRE(text.find("CWT_ns") != std::string_view::npos);
+    REQUIRE(text.find("historical 112233445566778899AABBCCDDEEFF\nTCK 00") !=
+            std::string_view::npos);
+  }
+  SECTION("specific mode") {
+    const auto bytes = "3B90 96 10 00"_h2b;
+    const atr::atr_view atr(bytes);
+    const auto text = to_view(atr::dump(atr, buffer));
+    REQUIRE(text.find("TA2 00 specific mode T=0 change capable\n") !=
+            std::string_view::npos);
+    REQUIRE(atr.specific_change_capable());
+  }
+  SECTION("specific mode, not change capable") {
+    const auto bytes = "3B80 10 81"_h2b;
+    const atr::atr_view atr(bytes);
+    const auto text = to_view(atr::dump(atr, buffer));
+    REQUIRE(text.find("TA2 81 specific mode T=1\n") != std::string_view::npos);
+    REQUIRE(!atr.specific_change_capable());
+  }
+  SECTION("buffer too small") {
+    const auto bytes = "3B00"_h2b;
+    const atr::atr_view atr(bytes);
+    REQUIRE(atr::dump(atr, gsl::span<char>(buffer).first(20)).empty());
+  }
+}
+
+TEST_CASE("dump", "[!benchmark]") {
+  std::array<char, 1024> buffer;
+  const auto bytes =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  const atr::atr_view atr(bytes);
+
+  BENCHMARK("text") { return atr::dump(atr, buffer).size(); };
+  BENCHMARK("JSON") {
+    return atr::dump(atr, buffer, atr::dump_format::json).size();
+  };
+  BENCHMARK("parse and JSON") {
+    return atr::dump(atr::atr_view(bytes), buffer, atr::dump_format::json)
+        .size();
+  };
+}
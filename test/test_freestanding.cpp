@@ -0,0 +1,160 @@
+// Tests of the library built with ATR_FREESTANDING, i.e. without exceptions,
+// RTTI and dynamic allocation. Catch2 needs all of these, so this is a plain
+// program returning the number of failed checks.
+
+#include "atr.hpp"
+#include "edc.hpp"
+#include "format.hpp"
+#include "pps.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+int failures = 0;
+bool heap_allowed = false;
+
+#define CHECK(expr)                                                            \
+  do {                                                                         \
+    if (!(expr)) {                                                             \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr);     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (false)
+
+template <std::size_t N>
+std::array<std::byte, N> bytes(const unsigned char (&values)[N]) {
+  std::array<std::byte, N> result;
+  for (std::size_t i = 0; i < N; i++)
+    result[i] = static_cast<std::byte>(values[i]);
+  return result;
+}
+
+void parse() {
+  std::error_code ec;
+  const auto valid = bytes({0x3B, 0x80, 0x80, 0x1F, 0x41, 0x5E});
+  const auto view = atr::atr_view::parse(valid, ec);
+  CHECK(view);
+  CHECK(!ec);
+  CHECK(view->bytes().data() == valid.data());
+  CHECK(view->T_present(15));
+  CHECK(view->ifsc() == 32);
+  CHECK(view->classes() == atr::operating_condition::A);
+
+  const auto invalid_ifsc = bytes({0x3B, 0x80, 0x80, 0x11, 0x00, 0x11});
+  CHECK(!atr::atr_view::parse(invalid_ifsc, ec));
+  CHECK(ec == atr::rule::invalid_ifsc);
+  CHECK(ec.category() == atr::atr_category());
+
+  const auto minimal = bytes({0x3B, 0x00});
+  CHECK(atr::atr_view::parse(minimal, ec));
+  CHECK(!atr::atr_view::parse(minimal, ec, atr::profile::EMV));
+  CHECK(ec == atr::rule::emv_TB1_absent);
+
+  const auto truncated = bytes({0x3B, 0x10});
+  CHECK(!atr::atr_view::parse(truncated, ec));
+  CHECK(ec == atr::rule::structure);
+  CHECK(atr::expected_size(truncated) == 3);
+
+  const auto noisy = bytes({0x00, 0x3B, 0x10, 0x00, 0x3B, 0x10, 0x96});
+  const auto found = atr::scan(noisy);
+  CHECK(found.atr && found.skipped == 4);
+  const auto incomplete = bytes({0x3B, 0x0F, 0x3B, 0x00, 0x11});
+  CHECK(!atr::scan(incomplete).atr);
+  CHECK(atr::scan(incomplete, atr::profile::ISO7816, true).skipped == 2);
+}
+
+void timings() {
+  const auto T1 = bytes({0x3B, 0x80, 0x81, 0x31, 0xFE, 0x45, 0x8B});
+  std::error_code ec;
+  const auto view = atr::atr_view::parse(T1, ec);
+  CHECK(view);
+  if (!view)
+    return;
+  CHECK(view->ifsc() == 0xFE);
+  CHECK(view->cwt(372, 1, 5'000'000).count() > 0);
+  CHECK(view->bwt(372, 1, 5'000'000) > view->cwt(372, 1, 5'000'000));
+  CHECK(view->code() == atr::redundancy_code::LRC);
+
+  const int F[] = {372, 512};
+  const int D[] = {1, 16};
+  const int freq[] = {5'000'000, 4'000'000};
+  std::array<atr::atr_view::duration, 2> cwt, bwt;
+  view->sweep(F, D, freq, {{}, {}, cwt, bwt});
+  CHECK(std::abs(cwt[0] / view->cwt(372, 1, 5'000'000) - 1) < 1e-12);
+  CHECK(bwt[1].count() > 0 && bwt[1] < view->bwt(372, 1, 4'000'000));
+}
+
+void dump() {
+  const auto T0 = bytes({0x3B, 0x10, 0x96});
+  std::error_code ec;
+  const auto view = atr::atr_view::parse(T0, ec);
+  CHECK(view);
+  if (!view)
+    return;
+  char out[512];
+  const auto text = atr::dump(*view, out, atr::dump_format::json);
+  CHECK(!text.empty());
+  CHECK(text.size() < sizeof(out) && text[0] == '{');
+  char small[8];
+  CHECK(atr::dump(*view, small).empty());
+}
+
+void pps() {
+  const auto T0 = bytes({0x3B, 0x10, 0x96});
+  std::error_code ec;
+  const auto view = atr::atr_view::parse(T0, ec);
+  CHECK(view);
+  if (!view)
+    return;
+  const auto req = atr::pps::propose(*view, 0);
+  CHECK(req);
+  if (!req)
+    return;
+  std::array<std::byte, atr::pps::max_size> out;
+  const auto encoded = atr::pps::encode(*req, out);
+  CHECK(encoded.size() == 4);
+  const auto result = atr::pps::validate(*req, encoded);
+  CHECK(result && result->F == 512 && result->D == 32);
+}
+
+void edc() {
+  const auto block = bytes({0x00, 0x00, 0x00});
+  std::array<std::byte, 2> out;
+  CHECK(atr::edc(atr::redundancy_code::LRC).update(block).write(out).size() ==
+        1);
+  CHECK(atr::edc(atr::redundancy_code::CRC).update(block).write(out).size() ==
+        2);
+}
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (!heap_allowed) {
+    std::printf("unexpected allocation of %zu bytes\n", size);
+    std::abort();
+  }
+  if (void *p = std::malloc(size))
+    return p;
+  std::abort();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+  parse();
+  timings();
+  dump();
+  pps();
+  edc();
+
+  // messages of the error category are the only strings built
+  heap_allowed = true;
+  const std::error_code ec = atr::rule::invalid_tck;
+  CHECK(ec.message() == atr::message(atr::rule::invalid_tck));
+
+  if (failures != 0)
+    std::printf("%d checks failed\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+#include "format.hpp"
+#include "metrics.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <numeric>
+#include <string_view>
+
+TEST_CASE("rejection reason") {
+  try {
+    atr::atr("3B80 80 11 00 11"_h2b);
+    FAIL("not rejected");
+  } catch (const atr::invalid_atr &e) {
+    REQUIRE(e.reason() == atr::rule::invalid_ifsc);
+    REQUIRE(std::string_view(e.what()) == atr::message(e.reason()));
+  }
+  try {
+    atr::atr("3B00"_h2b, atr::profile::EMV);
+    FAIL("not rejected");
+  } catch (const atr::invalid_atr &e) {
+    REQUIRE(e.reason() == atr::rule::emv_TB1_absent);
+  }
+}
+
+// The counters are compiled out without ATR_ENABLE_METRICS. The test is then
+// hidden, so that it does not pass without checking anything.
+#ifdef ATR_ENABLE_METRICS
+#define METRICS_TAGS "[metrics]"
+#else
+#define METRICS_TAGS "[.][metrics]"
+
+TEST_CASE("metrics compiled out") {
+  atr::metrics::reset();
+  atr::atr("3B00"_h2b);
+  REQUIRE_THROWS(atr::atr("3B10 00"_h2b));
+  const auto s = atr::metrics::collect();
+  REQUIRE(!atr::metrics::enabled);
+  REQUIRE(s.accepted == 0);
+  REQUIRE(std::accumulate(s.rejected.begin(), s.rejected.end(), 0ull) == 0);
+}
+#endif
+
+TEST_CASE("metrics", METRICS_TAGS) {
+  atr::metrics::reset();
+  atr::atr("3B00"_h2b);
+  atr::atr("3B90 96 10 00"_h2b);
+  atr::atr("3B80 80 1F 41 5E"_h2b);
+  REQUIRE_THROWS(atr::atr("3B10 00"_h2b));
+  REQUIRE_THROWS(atr::atr("3B80 10 40"_h2b));
+  REQUIRE_THROWS(atr::atr("3B00 00"_h2b));
+
+  const auto s = atr::metrics::collect();
+  REQUIRE(s.accepted == 3);
+  REQUIRE(s.rejected[static_cast<std::size_t>(atr::rule::invalid_Di)] == 1);
+  REQUIRE(s.rejected[static_cast<std::size_t>(atr::rule::TA2_rfu)] == 1);
+  REQUIRE(s.rejected[static_cast<std::size_t>(atr::rule::too_many_bytes)] ==
+          1);
+  REQUIRE(s.protocols[0] == 3);
+  REQUIRE(s.protocols[15] == 1);
+  REQUIRE(s.TA1[0x96] == 1);
+  REQUIRE(s.TA1_absent == 2);
+  REQUIRE(std::accumulate(s.parse_ns.begin(), s.parse_ns.end(), 0ull) == 3);
+
+  SECTION("export") {
+    std::array<char, 2048> buffer;
+    const auto text = atr::dump(s, buffer);
+    CAPTURE(std::string_view(text.data(), text.size()));
+    REQUIRE(std::string_view(text.data(), text.size())
+                .find("rejected[invalid Di] 1\n") != std::string_view::npos);
+    const auto json = atr::dump(s, buffer, atr::dump_format::json);
+    REQUIRE(std::string_view(json.data(), json.size())
+                .find("\"TA1\":{\"96\":1,\"absent\":2}") !=
+            std::string_view::npos);
+  }
+  SECTION("reset") {
+    atr::metrics::reset();
+    REQUIRE(atr::metrics::collect().accepted == 0);
+  }
+  SECTION("scan") {
+    // the rejected candidate is not counted, the ATR once per scan
+    atr::metrics::reset();
+    const auto bytes = "3B80 80 1F 41 00 3B80 80 1F 41 5E"_h2b;
+    REQUIRE(atr::scan(gsl::span<const std::byte>(bytes).first(8)).skipped ==
+            6);
+    REQUIRE(atr::scan(bytes).atr);
+    const auto scanned = atr::metrics::collect();
+    REQUIRE(scanned.accepted == 1);
+    REQUIRE(std::accumulate(scanned.rejected.begin(), scanned.rejected.end(),
+                            0ull) == 0);
+  }
+}
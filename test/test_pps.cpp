@@ -0,0 +1,115 @@
+#include "pps.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+namespace {
+std::pmr::vector<std::byte> to_vector(gsl::span<const std::byte> s) {
+  return {s.begin(), s.end()};
+}
+} // namespace
+
+TEST_CASE("PPS proposal") {
+  SECTION("negotiable mode with TA1") {
+    atr::atr atr("3B10 96"_h2b);
+    auto req = atr::pps::propose(atr, 0);
+    REQUIRE(req);
+    REQUIRE(req->T == 0);
+    REQUIRE(req->PPS1 == std::byte{0x96});
+    REQUIRE(!req->PPS2);
+    REQUIRE(!req->PPS3);
+  }
+  SECTION("default TA1") {
+    auto req = atr::pps::propose(atr::atr("3B00"_h2b), 0);
+    REQUIRE(req);
+    REQUIRE(!req->PPS1);
+  }
+  SECTION("protocol must be offered") {
+    atr::atr atr("3B80 01 81"_h2b);
+    REQUIRE(atr::pps::propose(atr, 1));
+    REQUIRE(!atr::pps::propose(atr, 0));
+    REQUIRE(!atr::pps::propose(atr::atr("3B00"_h2b), 1));
+  }
+  SECTION("specific mode") {
+    REQUIRE(!atr::pps::propose(atr::atr("3B90 96 10 00"_h2b), 0));
+    REQUIRE(!atr::pps::propose(atr::atr("3B90 96 10 80"_h2b), 0));
+  }
+}
+
+TEST_CASE("PPS availability") {
+  using atr::pps::availability;
+  SECTION("negotiable mode") {
+    atr::atr atr("3B80 01 81"_h2b);
+    REQUIRE(atr::pps::available(atr, 1) == availability::available);
+    REQUIRE(atr::pps::available(atr, 0) == availability::none);
+    REQUIRE(atr::pps::available(atr, 15) == availability::none);
+  }
+  SECTION("specific mode, change capable") {
+    atr::atr atr("3B90 96 10 00"_h2b);
+    REQUIRE(atr::pps::available(atr, 0) == availability::warm_reset);
+    REQUIRE(atr::pps::available(atr, 1) == availability::warm_reset);
+  }
+  SECTION("specific mode only") {
+    atr::atr atr("3B90 96 10 80"_h2b);
+    REQUIRE(atr::pps::available(atr, 0) == availability::none);
+  }
+}
+
+TEST_CASE("PPS encoding") {
+  std::array<std::byte, atr::pps::max_size> buffer;
+  SECTION("PPS1") {
+    atr::pps::request req{0, std::byte{0x96}, {}, {}};
+    REQUIRE(to_vector(atr::pps::encode(req, buffer)) == "FF10 96 79"_h2b);
+  }
+  SECTION("T only") {
+    atr::pps::request req{1, {}, {}, {}};
+    REQUIRE(to_vector(atr::pps::encode(req, buffer)) == "FF01 FE"_h2b);
+  }
+  SECTION("all parameters") {
+    atr::pps::request req{1, std::byte{0x13}, std::byte{0x00},
+                          std::byte{0x00}};
+    REQUIRE(to_vector(atr::pps::encode(req, buffer)) ==
+            "FF71 130000 9D"_h2b);
+  }
+  SECTION("buffer too small") {
+    atr::pps::request req{0, std::byte{0x96}, {}, {}};
+    REQUIRE(atr::pps::encode(req, gsl::span(buffer).first(3)).empty());
+  }
+}
+
+TEST_CASE("PPS response") {
+  atr::pps::request req{0, std::byte{0x96}, {}, {}};
+
+  SECTION("expected size") {
+    REQUIRE(atr::pps::expected_size({}) == 2);
+    REQUIRE(atr::pps::expected_size("FF"_h2b) == 2);
+    REQUIRE(atr::pps::expected_size("FF10"_h2b) == 4);
+    REQUIRE(atr::pps::expected_size("FF71"_h2b) == 6);
+    REQUIRE(atr::pps::expected_size("3B"_h2b) == 0);
+  }
+  SECTION("echo") {
+    auto res = atr::pps::validate(req, "FF10 96 79"_h2b);
+    REQUIRE(res);
+    REQUIRE(res->T == 0);
+    REQUIRE(res->F == 512);
+    REQUIRE(res->D == 32);
+  }
+  SECTION("PPS1 not accepted") {
+    auto res = atr::pps::validate(req, "FF00 FF"_h2b);
+    REQUIRE(res);
+    REQUIRE(res->F == 372);
+    REQUIRE(res->D == 1);
+  }
+  SECTION("failed") {
+    auto response = GENERATE("FF10 96 78"_h2b, // PCK
+                             "FF11 96 78"_h2b, // different T
+                             "FF10 95 7A"_h2b, // different PPS1
+                             "FF30 9600 59"_h2b, // PPS2 not requested
+                             "FF10 96"_h2b,      // too short
+                             "FF10 96 79 00"_h2b // too long
+    );
+    CAPTURE(response);
+    REQUIRE(!atr::pps::validate(req, response));
+  }
+}
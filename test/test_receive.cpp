@@ -11,11 +11,12 @@
 #include <gsl/span_ext>
 
 struct fake_sender {
-  const std::vector<std::byte> data_;
+  const std::pmr::vector<std::byte> data_;
   const bool fail_on_underflow_;
   gsl::span<std::byte const> remaining_;
 
-  fake_sender(std::vector<std::byte> to_send, bool fail_on_underflow = true)
+  fake_sender(std::pmr::vector<std::byte> to_send,
+              bool fail_on_underflow = true)
       : data_(to_send), fail_on_underflow_(fail_on_underflow),
         remaining_(data_) {}
   bool operator()(gsl::span<std::byte> buffer) {
@@ -45,6 +46,16 @@ TEST_CASE("valid ATRs") {
   REQUIRE(atr::receive(sender) == atr);
 }
 
+TEST_CASE("ATR allocated from arena") {
+  std::array<std::byte, 64> memory;
+  std::pmr::monotonic_buffer_resource arena(memory.data(), memory.size(),
+                                            std::pmr::null_memory_resource());
+  fake_sender sender{"3b01 11"_h2b};
+  const auto atr = atr::receive(sender, &arena);
+  REQUIRE(atr == "3b01 11"_h2b);
+  REQUIRE(atr.get_allocator().resource() == &arena);
+}
+
 TEST_CASE("invalid ATRs") {
   auto atr = GENERATE(""_h2b, "ff"_h2b, "3b10"_h2b,
                       "3bF0 112233F4 112233F4 112233F4 112233F4 112233F4 "
@@ -52,4 +63,148 @@ TEST_CASE("invalid ATRs") {
   CAPTURE(atr);
   fake_sender sender{atr, false};
   REQUIRE(atr::receive(sender) == ""_h2b);
-}
\ No newline at end of file
+}
+
+struct chunked_sender {
+  const std::pmr::vector<std::byte> data_;
+  const std::size_t chunk_size_;
+  gsl::span<std::byte const> remaining_;
+  std::size_t reads_ = 0;
+
+  chunked_sender(std::pmr::vector<std::byte> to_send, std::size_t chunk_size)
+      : data_(to_send), chunk_size_(chunk_size), remaining_(data_) {}
+  std::size_t operator()(gsl::span<std::byte> buffer) {
+    auto n = std::min({chunk_size_, buffer.size(), remaining_.size()});
+    copy(remaining_.first(n), buffer);
+    remaining_ = remaining_.subspan(n);
+    reads_++;
+    return n;
+  }
+};
+
+TEST_CASE("valid ATRs, chunked") {
+  auto atr =
+      GENERATE("3b00"_h2b, "3b01 11"_h2b,
+               "3b0f 112233445566778899aabbccddeeff"_h2b, "3b10 23"_h2b,
+               "3bF0 6677880f AA"_h2b, "3b80 F0 66778800"_h2b,
+               "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b);
+  auto chunk_size = GENERATE(1, 3, 64);
+  CAPTURE(atr, chunk_size);
+  chunked_sender sender{atr, static_cast<std::size_t>(chunk_size)};
+  atr::receiver receiver{std::ref(sender)};
+  std::array<std::byte, atr::max_atr_size> buffer;
+
+  auto received = receiver.receive(buffer);
+  REQUIRE(std::pmr::vector<std::byte>(received.begin(), received.end()) == atr);
+  REQUIRE(receiver.pending().size() == 0);
+  if (chunk_size == 64)
+    REQUIRE(sender.reads_ == 1);
+}
+
+TEST_CASE("chunked receive keeps trailing bytes") {
+  chunked_sender sender{"3b80 F0 66778800 A1A2A3"_h2b, 64};
+  atr::receiver receiver{std::ref(sender)};
+  std::array<std::byte, atr::max_atr_size> buffer;
+
+  auto received = receiver.receive(buffer);
+  REQUIRE(std::pmr::vector<std::byte>(received.begin(), received.end()) ==
+          "3b80 F0 66778800"_h2b);
+  auto pending = receiver.pending();
+  REQUIRE(std::pmr::vector<std::byte>(pending.begin(), pending.end()) ==
+          "A1A2A3"_h2b);
+}
+
+TEST_CASE("invalid ATRs, chunked") {
+  auto atr = GENERATE(""_h2b, "ff"_h2b, "3b10"_h2b,
+                      "3bF0 112233F4 112233F4 112233F4 112233F4 112233F4 "
+                      "112233F4 112233F4 112233F4"_h2b);
+  CAPTURE(atr);
+  chunked_sender sender{atr, 64};
+  atr::receiver receiver{std::ref(sender)};
+  std::array<std::byte, atr::max_atr_size> buffer;
+
+  REQUIRE(receiver.receive(buffer).size() == 0);
+  REQUIRE(receiver.pending().size() == 0);
+}
+
+TEST_CASE("scan for TS") {
+  SECTION("valid ATR at the start") {
+    const auto bytes = "3B00"_h2b;
+    const auto result = atr::scan(bytes);
+    REQUIRE(result.atr);
+    REQUIRE(result.skipped == 0);
+    REQUIRE(result.atr->bytes().data() == bytes.data());
+  }
+  SECTION("noise before the ATR") {
+    const auto bytes = "00 FF 3B 12 3F 10 00 3B80 80 1F 41 5E"_h2b;
+    const auto result = atr::scan(bytes);
+    REQUIRE(result.atr);
+    REQUIRE(result.skipped == 7);
+    REQUIRE(result.atr->bytes().size() == 6);
+    REQUIRE(result.atr->T_present(15));
+  }
+  SECTION("inverse convention") {
+    const auto result = atr::scan("AA 3F10 96"_h2b);
+    REQUIRE(result.atr);
+    REQUIRE(result.skipped == 1);
+    REQUIRE(result.atr->Di() == 32);
+  }
+  SECTION("candidate with invalid TCK") {
+    const auto bytes = "3B80 80 1F 41 00 3B80 80 1F 41 5E"_h2b;
+    const auto result = atr::scan(bytes);
+    REQUIRE(result.atr);
+    REQUIRE(result.skipped == 6);
+  }
+  SECTION("incomplete ATR") {
+    const auto bytes = "0011 3BFF 11BB00"_h2b;
+    const auto result = atr::scan(bytes);
+    REQUIRE(!result.atr);
+    REQUIRE(result.skipped == 2);
+    const auto idle = atr::scan(bytes, atr::profile::ISO7816, true);
+    REQUIRE(!idle.atr);
+    REQUIRE(idle.skipped == bytes.size());
+  }
+  SECTION("ATR within an incomplete candidate") {
+    const auto bytes = "3B0F 3B00 11"_h2b;
+    // more bytes may complete the first candidate
+    const auto pending = atr::scan(bytes);
+    REQUIRE(!pending.atr);
+    REQUIRE(pending.skipped == 0);
+    // no more bytes arrive, the first candidate is only noise
+    const auto idle = atr::scan(bytes, atr::profile::ISO7816, true);
+    REQUIRE(idle.atr);
+    REQUIRE(idle.skipped == 2);
+    REQUIRE(idle.atr->bytes().size() == 2);
+  }
+  SECTION("TS as last byte") {
+    const auto result = atr::scan("0011 3B"_h2b);
+    REQUIRE(!result.atr);
+    REQUIRE(result.skipped == 2);
+  }
+  SECTION("no candidate") {
+    const auto result = atr::scan("00112233"_h2b);
+    REQUIRE(!result.atr);
+    REQUIRE(result.skipped == 4);
+    REQUIRE(atr::scan({}).skipped == 0);
+  }
+  SECTION("profile") {
+    const auto bytes = "3B00 3B60 00 00"_h2b;
+    REQUIRE(atr::scan(bytes).skipped == 0);
+    const auto emv = atr::scan(bytes, atr::profile::EMV);
+    REQUIRE(emv.atr);
+    REQUIRE(emv.skipped == 2);
+  }
+}
+
+TEST_CASE("scan", "[!benchmark]") {
+  // TS candidates followed by TD chains that are too long
+  std::pmr::vector<std::byte> noise(1024, std::byte{0xFF});
+  for (std::size_t i = 0; i < noise.size(); i += 97)
+    noise[i] = std::byte{0x3B};
+  const auto atr =
+      "3BFF 11BB0081 71 EF1200 151413121110090807060504030201 58"_h2b;
+  noise.insert(noise.end(), atr.begin(), atr.end());
+  REQUIRE(atr::scan(noise).skipped == 1024);
+
+  BENCHMARK("1k noise") { return atr::scan(noise).skipped; };
+}
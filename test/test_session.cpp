@@ -0,0 +1,161 @@
+#include "session.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <map>
+
+using namespace std::chrono_literals;
+
+namespace {
+// records the actions of a session pool, echoes PPS requests if enabled
+struct simulated_cards {
+  std::map<std::size_t, std::pmr::vector<std::byte>> sent;
+  std::vector<std::pair<std::size_t, atr::session_state>> events;
+
+  atr::session_pool make_pool(std::size_t sessions) {
+    return atr::session_pool(
+        sessions, 5'000'000,
+        [this](std::size_t id, gsl::span<const std::byte> data) {
+          sent[id].insert(sent[id].end(), data.begin(), data.end());
+        },
+        [this](std::size_t id, const atr::session &s) {
+          events.emplace_back(id, s.state());
+        });
+  }
+};
+
+const auto start = atr::session::clock::time_point{} + 1h;
+} // namespace
+
+TEST_CASE("session without PPS") {
+  simulated_cards cards;
+  auto pool = cards.make_pool(1);
+  pool.reset(0, start);
+  REQUIRE(pool[0].state() == atr::session_state::receiving_atr);
+
+  SECTION("T=0") {
+    pool.on_bytes(0, "3B02 1122"_h2b, start + 1ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(pool[0].protocol() == atr::protocol_state::T0);
+    REQUIRE(pool[0].F() == 372);
+    REQUIRE(pool[0].D() == 1);
+    REQUIRE(cards.sent.empty());
+  }
+  SECTION("T=1") {
+    pool.on_bytes(0, "3B80 01 81"_h2b, start + 1ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(pool[0].protocol() == atr::protocol_state::T1);
+  }
+  SECTION("specific mode") {
+    pool.on_bytes(0, "3B90 96 10 00"_h2b, start + 1ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(pool[0].protocol() == atr::protocol_state::T0);
+    REQUIRE(pool[0].F() == 512);
+    REQUIRE(pool[0].D() == 32);
+    REQUIRE(cards.sent.empty());
+    REQUIRE(pool[0].pps_availability() == atr::pps::availability::warm_reset);
+  }
+  SECTION("specific mode only") {
+    pool.on_bytes(0, "3B90 96 10 80"_h2b, start + 1ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(pool[0].pps_availability() == atr::pps::availability::none);
+  }
+  SECTION("byte by byte") {
+    for (auto b : "3B02 1122"_h2b) {
+      REQUIRE(pool[0].state() == atr::session_state::receiving_atr);
+      pool.on_bytes(0, gsl::span<const std::byte>(&b, 1), start + 1ms);
+    }
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(cards.events.size() == 1);
+  }
+  SECTION("invalid ATR") {
+    pool.on_bytes(0, "3B10 00"_h2b, start + 1ms);
+    REQUIRE(pool[0].state() == atr::session_state::failed);
+    REQUIRE(cards.events.size() == 1);
+  }
+}
+
+TEST_CASE("session with PPS") {
+  simulated_cards cards;
+  auto pool = cards.make_pool(1);
+  pool.reset(0, start);
+  pool.on_bytes(0, "3B10 96"_h2b, start + 1ms);
+  REQUIRE(pool[0].state() == atr::session_state::negotiating);
+  REQUIRE(pool[0].protocol() == atr::protocol_state::PPS);
+  REQUIRE(cards.sent[0] == "FF10 96 79"_h2b);
+
+  SECTION("accepted") {
+    pool.on_bytes(0, "FF10 96 79"_h2b, start + 2ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(pool[0].F() == 512);
+    REQUIRE(pool[0].D() == 32);
+    REQUIRE(pool[0].pps_availability() == atr::pps::availability::available);
+  }
+  SECTION("Fi/Di not accepted") {
+    pool.on_bytes(0, "FF00 FF"_h2b, start + 2ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+    REQUIRE(pool[0].F() == 372);
+    REQUIRE(pool[0].D() == 1);
+  }
+  SECTION("invalid response") {
+    pool.on_bytes(0, "FF10 96 78"_h2b, start + 2ms);
+    REQUIRE(pool[0].state() == atr::session_state::failed);
+  }
+  SECTION("no response within WT") {
+    // WT = 960 * 10 * 512 / 5MHz
+    pool.advance(start + 900ms);
+    REQUIRE(pool[0].state() == atr::session_state::negotiating);
+    pool.advance(start + 1001ms);
+    REQUIRE(pool[0].state() == atr::session_state::failed);
+  }
+}
+
+TEST_CASE("session timeouts") {
+  simulated_cards cards;
+  auto pool = cards.make_pool(2);
+  pool.reset(0, start);
+  pool.reset(1, start);
+
+  SECTION("no ATR") {
+    // 40000 clock cycles at 5MHz
+    pool.advance(start + 7ms);
+    REQUIRE(pool[0].state() == atr::session_state::receiving_atr);
+    pool.advance(start + 9ms);
+    REQUIRE(pool[0].state() == atr::session_state::failed);
+    REQUIRE(pool[1].state() == atr::session_state::failed);
+    REQUIRE(pool.next_deadline() == atr::session::clock::time_point::max());
+  }
+  SECTION("character waiting time extended by received bytes") {
+    // 9600 etu at 5MHz are ~714ms
+    pool.on_bytes(0, "3B01"_h2b, start + 1ms);
+    pool.advance(start + 500ms);
+    REQUIRE(pool[0].state() == atr::session_state::receiving_atr);
+    REQUIRE(pool[1].state() == atr::session_state::failed);
+    pool.on_bytes(0, "AA"_h2b, start + 600ms);
+    REQUIRE(pool[0].state() == atr::session_state::established);
+  }
+  SECTION("character waiting time exceeded") {
+    pool.on_bytes(0, "3B01"_h2b, start + 1ms);
+    pool.advance(start + 720ms);
+    REQUIRE(pool[0].state() == atr::session_state::failed);
+  }
+}
+
+TEST_CASE("many sessions") {
+  constexpr std::size_t sessions = 5000;
+  simulated_cards cards;
+  auto pool = cards.make_pool(sessions);
+  for (std::size_t id = 0; id < sessions; id++)
+    pool.reset(id, start);
+  for (std::size_t id = 0; id < sessions; id++)
+    pool.on_bytes(id, id % 2 ? "3B10 96"_h2b : "3B02 1122"_h2b, start + 1ms);
+  for (auto &[id, request] : cards.sent)
+    pool.on_bytes(id, request, start + 2ms);
+  pool.advance(start + 10s);
+
+  REQUIRE(cards.events.size() == sessions);
+  for (std::size_t id = 0; id < sessions; id++)
+    REQUIRE(pool[id].state() == atr::session_state::established);
+}
@@ -0,0 +1,268 @@
+#include "t0.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <algorithm>
+#include <deque>
+
+namespace {
+// card side of T=0 with a few commands:
+//   INS 10, case 1: no data
+//   INS B0, case 2: returns P3 bytes 0, 1, 2, ..., 6C if P3 != size
+//   INS D6, case 3: stores the data
+//   INS 88, case 4: stores the data, returns it reversed via GET RESPONSE
+// Characters take delay each on the clock of the card.
+struct fake_card {
+  int nulls = 0;             // NULL bytes before each procedure byte
+  bool single = false;       // ACK every byte with INS ^ FF
+  std::size_t size = 0;      // length expected by B0, 0 accepts any
+  std::byte procedure{0x00}; // replaces the ACK if not 00
+  bool mute = false;         // card does not answer at all
+  atr::atr::duration delay{0.001};
+
+  std::vector<std::byte> header;
+  std::vector<std::byte> data;
+  std::size_t expected = 0;
+  std::vector<std::byte> stored;
+  std::deque<std::byte> outbox;
+  atr::atr::duration now{0};
+  int commands = 0;
+  std::vector<const std::byte *> sent_from;
+  std::vector<std::byte *> received_into;
+
+  bool send(gsl::span<const std::byte> bytes) {
+    sent_from.push_back(bytes.data());
+    for (const auto b : bytes) {
+      if (header.size() < 5) {
+        header.push_back(b);
+        if (header.size() == 5)
+          command();
+      } else {
+        data.push_back(b);
+        if (single && data.size() < expected)
+          ack(~header[1]);
+        if (data.size() == expected)
+          processed();
+      }
+    }
+    return true;
+  }
+
+  bool recv(gsl::span<std::byte> buffer, atr::atr::duration timeout) {
+    received_into.push_back(buffer.data());
+    if (mute || buffer.size() > outbox.size())
+      return false;
+    for (auto &b : buffer) {
+      b = outbox.front();
+      outbox.pop_front();
+      now += delay;
+    }
+    return true;
+  }
+
+  void emit(std::byte b) {
+    for (int i = 0; i < nulls; i++)
+      outbox.push_back(std::byte{0x60});
+    outbox.push_back(b);
+  }
+  void ack(std::byte b) { emit(procedure != std::byte{0} ? procedure : b); }
+  void status(std::byte sw1, std::byte sw2) {
+    emit(sw1);
+    outbox.push_back(sw2);
+    header.clear();
+    data.clear();
+  }
+
+  void command() {
+    commands++;
+    const auto ins = header[1];
+    const auto P3 = std::to_integer<std::size_t>(header[4]);
+    if (ins == std::byte{0x10}) {
+      status(std::byte{0x90}, std::byte{0x00});
+    } else if (ins == std::byte{0xB0}) {
+      if (size != 0 && P3 != size)
+        return status(std::byte{0x6C}, static_cast<std::byte>(size));
+      std::vector<std::byte> response;
+      for (std::size_t i = 0; i < (P3 == 0 ? 256 : P3); i++)
+        response.push_back(static_cast<std::byte>(i));
+      respond(response);
+    } else if (ins == std::byte{0xD6} || ins == std::byte{0x88}) {
+      expected = P3;
+      ack(single ? ~ins : ins);
+    } else if (ins == std::byte{0xC0}) {
+      std::vector<std::byte> response(stored.rbegin(), stored.rend());
+      response.resize(P3);
+      respond(response);
+    } else {
+      status(std::byte{0x6D}, std::byte{0x00});
+    }
+  }
+
+  void processed() {
+    stored = data;
+    if (header[1] == std::byte{0x88})
+      status(std::byte{0x61}, static_cast<std::byte>(stored.size()));
+    else
+      status(std::byte{0x90}, std::byte{0x00});
+  }
+
+  void respond(const std::vector<std::byte> &response) {
+    const auto ins = header[1];
+    if (single) {
+      for (const auto b : response) {
+        ack(~ins);
+        outbox.push_back(b);
+      }
+    } else {
+      ack(ins);
+      outbox.insert(outbox.end(), response.begin(), response.end());
+    }
+    status(std::byte{0x90}, std::byte{0x00});
+  }
+};
+
+atr::t0::transport make_transport(const atr::atr &atr, fake_card &card) {
+  return atr::t0::transport(
+      atr, 372, 1, 5'000'000,
+      [&card](gsl::span<const std::byte> data) { return card.send(data); },
+      [&card](gsl::span<std::byte> buffer, atr::atr::duration timeout) {
+        return card.recv(buffer, timeout);
+      },
+      [&card] { return card.now; });
+}
+
+std::pmr::vector<std::byte> to_vector(gsl::span<const std::byte> s) {
+  return {s.begin(), s.end()};
+}
+} // namespace
+
+TEST_CASE("T=0 configuration from ATR") {
+  atr::atr atr("3B40 20"_h2b);
+  fake_card card;
+  auto transport = make_transport(atr, card);
+  REQUIRE(transport.wt() == atr.wt(5'000'000));
+  REQUIRE(transport.gt() == atr.gt(372, 1, 5'000'000));
+}
+
+TEST_CASE("T=0 APDU cases") {
+  atr::atr atr("3B00"_h2b);
+  fake_card card;
+  card.nulls = GENERATE(0, 2);
+  card.single = GENERATE(false, true);
+  auto transport = make_transport(atr, card);
+  std::array<std::byte, 300> buffer;
+
+  SECTION("case 1") {
+    const auto response = transport.transceive("00100000"_h2b, buffer);
+    REQUIRE(to_vector(response) == "9000"_h2b);
+    REQUIRE(card.commands == 1);
+  }
+  SECTION("case 2") {
+    const auto response = transport.transceive("00B0000004"_h2b, buffer);
+    REQUIRE(to_vector(response) == "00010203 9000"_h2b);
+  }
+  SECTION("case 2, 256 bytes") {
+    const auto response = transport.transceive("00B0000000"_h2b, buffer);
+    REQUIRE(response.size() == 258);
+    REQUIRE(response[255] == std::byte{0xFF});
+  }
+  SECTION("case 3") {
+    const auto response =
+        transport.transceive("00D6000003 AABBCC"_h2b, buffer);
+    REQUIRE(to_vector(response) == "9000"_h2b);
+    REQUIRE(to_vector(card.stored) == "AABBCC"_h2b);
+  }
+  SECTION("case 4, GET RESPONSE") {
+    const auto response =
+        transport.transceive("0088000003 AABBCC 00"_h2b, buffer);
+    REQUIRE(to_vector(response) == "CCBBAA 9000"_h2b);
+    REQUIRE(card.commands == 2);
+  }
+}
+
+TEST_CASE("T=0 exchange") {
+  atr::atr atr("3B00"_h2b);
+  fake_card card;
+  auto transport = make_transport(atr, card);
+  std::array<std::byte, 300> buffer;
+
+  SECTION("case 4, GET RESPONSE limited by Le") {
+    const auto response =
+        transport.transceive("0088000003 AABBCC 02"_h2b, buffer);
+    REQUIRE(to_vector(response) == "CCBB 9000"_h2b);
+  }
+  SECTION("wrong length, 6Cxx") {
+    card.size = 2;
+    const auto response = transport.transceive("00B0000004"_h2b, buffer);
+    REQUIRE(to_vector(response) == "0001 9000"_h2b);
+    REQUIRE(card.commands == 2);
+  }
+  SECTION("status only") {
+    const auto response = transport.transceive("00FF000004"_h2b, buffer);
+    REQUIRE(to_vector(response) == "6D00"_h2b);
+  }
+  SECTION("zero copy") {
+    const auto apdu = "00D6000003 AABBCC"_h2b;
+    transport.transceive(apdu, buffer);
+    REQUIRE(card.sent_from.size() == 2);
+    REQUIRE(card.sent_from[0] == apdu.data());
+    REQUIRE(card.sent_from[1] == apdu.data() + 5);
+
+    card.received_into.clear();
+    transport.transceive("00B0000004"_h2b, buffer);
+    REQUIRE(std::find(card.received_into.begin(), card.received_into.end(),
+                      buffer.data()) != card.received_into.end());
+  }
+}
+
+TEST_CASE("T=0 errors") {
+  atr::atr atr("3B00"_h2b);
+  fake_card card;
+  auto transport = make_transport(atr, card);
+  std::array<std::byte, 300> buffer;
+
+  SECTION("WT exceeded") {
+    card.delay = atr.wt(5'000'000) * 1.5;
+    REQUIRE_THROWS_AS(transport.transceive("00100000"_h2b, buffer),
+                      atr::t0::protocol_error);
+  }
+  SECTION("NULL bytes restart WT") {
+    card.delay = atr.wt(5'000'000) * 0.9;
+    card.nulls = 3;
+    REQUIRE(transport.transceive("00100000"_h2b, buffer).size() == 2);
+  }
+  SECTION("no response") {
+    card.mute = true;
+    REQUIRE_THROWS_AS(transport.transceive("00B0000004"_h2b, buffer),
+                      atr::t0::protocol_error);
+  }
+  SECTION("invalid procedure byte") {
+    card.procedure = std::byte{0x42};
+    REQUIRE_THROWS_AS(transport.transceive("00D6000001 AA"_h2b, buffer),
+                      atr::t0::protocol_error);
+  }
+  SECTION("response buffer too small") {
+    REQUIRE_THROWS_AS(transport.transceive("00B0000004"_h2b,
+                                           gsl::span<std::byte>(buffer)
+                                               .first(5)),
+                      atr::t0::protocol_error);
+  }
+  SECTION("extended APDU") {
+    REQUIRE_THROWS_AS(transport.transceive("00D6000000 0001 AA"_h2b, buffer),
+                      std::invalid_argument);
+  }
+}
+
+TEST_CASE("T=0", "[!benchmark]") {
+  atr::atr atr("3B00"_h2b);
+  fake_card card;
+  auto transport = make_transport(atr, card);
+  std::array<std::byte, 300> buffer;
+  const auto case2 = "00B0000010"_h2b;
+  const auto case4 = "0088000008 0001020304050607 00"_h2b;
+
+  BENCHMARK("case 2") { return transport.transceive(case2, buffer).size(); };
+  BENCHMARK("case 4") { return transport.transceive(case4, buffer).size(); };
+}
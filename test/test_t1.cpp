@@ -0,0 +1,272 @@
+#include "t1.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+#include <algorithm>
+#include <deque>
+
+namespace {
+std::byte lrc(const std::vector<std::byte> &data) {
+  std::byte value{0};
+  for (auto b : data)
+    value ^= b;
+  return value;
+}
+
+// card side of T=1, answers every APDU with the APDU followed by 9000
+struct fake_card {
+  std::size_t ifsd = 32;
+  std::size_t send_ifs = 0;  // send IFS request with this IFSC
+  int wtx_requests = 0;      // WTX requests before the response
+  int corrupt_responses = 0; // number of responses sent with broken LRC
+  int reject_blocks = 0;     // I-blocks answered by R-blocks requesting them
+  int corrupt_r_blocks = 0;  // number of R-blocks sent with broken LRC
+
+  std::vector<std::byte> inbox;
+  std::deque<std::byte> outbox;
+  std::vector<std::byte> apdu;
+  std::vector<std::byte> response;
+  std::vector<std::byte> last_block;
+  std::size_t sent = 0;
+  std::size_t last_chunk = 0;
+  bool ns = false;
+  bool nr = false;
+  int blocks_received = 0;
+  std::size_t largest_inf = 0; // of the I-blocks received
+  std::vector<int> wtx_seen;
+
+  bool send(gsl::span<const std::byte> data) {
+    inbox.insert(inbox.end(), data.begin(), data.end());
+    if (inbox.size() >= 4 &&
+        inbox.size() == 4 + std::to_integer<std::size_t>(inbox[2])) {
+      REQUIRE(lrc(inbox) == std::byte{0});
+      process(inbox[1], {inbox.begin() + 3, inbox.end() - 1});
+      inbox.clear();
+    }
+    return true;
+  }
+
+  bool recv(gsl::span<std::byte> buffer, atr::atr::duration timeout) {
+    if (buffer.size() > outbox.size())
+      return false;
+    for (auto &b : buffer) {
+      b = outbox.front();
+      outbox.pop_front();
+    }
+    return true;
+  }
+
+  void emit(std::byte pcb, std::vector<std::byte> inf) {
+    std::vector<std::byte> block{std::byte{0}, pcb,
+                                 static_cast<std::byte>(inf.size())};
+    block.insert(block.end(), inf.begin(), inf.end());
+    block.push_back(lrc(block));
+    last_block = block;
+    push(block);
+  }
+
+  void push(std::vector<std::byte> block) {
+    if (corrupt_responses && (block[1] & std::byte{0x80}) == std::byte{0}) {
+      corrupt_responses--;
+      block.back() ^= std::byte{0xFF};
+    }
+    if (corrupt_r_blocks && (block[1] & std::byte{0xC0}) == std::byte{0x80}) {
+      corrupt_r_blocks--;
+      block.back() ^= std::byte{0xFF};
+    }
+    outbox.insert(outbox.end(), block.begin(), block.end());
+  }
+
+  void emit_chunk() {
+    auto remaining = response.size() - sent;
+    last_chunk = std::min(remaining, ifsd);
+    const bool more = last_chunk < remaining;
+    emit(std::byte((ns ? 0x40 : 0) | (more ? 0x20 : 0)),
+         {response.begin() + sent, response.begin() + sent + last_chunk});
+    ns = !ns;
+  }
+
+  void respond() {
+    if (wtx_requests) {
+      wtx_requests--;
+      emit(std::byte{0xC3}, {std::byte{2}});
+      return;
+    }
+    if (send_ifs) {
+      emit(std::byte{0xC1}, {std::byte(send_ifs)});
+      send_ifs = 0;
+      return;
+    }
+    response = apdu;
+    response.push_back(std::byte{0x90});
+    response.push_back(std::byte{0x00});
+    apdu.clear();
+    sent = 0;
+    emit_chunk();
+  }
+
+  void process(std::byte pcb, std::vector<std::byte> inf) {
+    blocks_received++;
+    if ((pcb & std::byte{0x80}) == std::byte{0}) {
+      // I-block
+      REQUIRE(((pcb & std::byte{0x40}) != std::byte{0}) == nr);
+      if (reject_blocks) {
+        reject_blocks--;
+        emit(std::byte(0x82 | (nr ? 0x10 : 0)), {});
+        return;
+      }
+      largest_inf = std::max(largest_inf, inf.size());
+      nr = !nr;
+      apdu.insert(apdu.end(), inf.begin(), inf.end());
+      if ((pcb & std::byte{0x20}) != std::byte{0})
+        emit(std::byte(0x80 | (nr ? 0x10 : 0)), {});
+      else
+        respond();
+    } else if ((pcb & std::byte{0xC0}) == std::byte{0x80}) {
+      // R-block
+      const bool block_nr = (pcb & std::byte{0x10}) != std::byte{0};
+      if (block_nr == ns && (pcb & std::byte{0x0F}) == std::byte{0}) {
+        sent += last_chunk;
+        emit_chunk();
+      } else {
+        push(last_block);
+      }
+    } else if (pcb == std::byte{0xE3}) {
+      wtx_seen.push_back(std::to_integer<int>(inf.at(0)));
+      respond();
+    } else if (pcb == std::byte{0xE1}) {
+      respond();
+    } else if (pcb == std::byte{0xC1}) {
+      ifsd = std::to_integer<std::size_t>(inf.at(0));
+      emit(std::byte{0xE1}, inf);
+    } else {
+      FAIL("unexpected block");
+    }
+  }
+};
+
+std::vector<std::byte> make_apdu(std::size_t size) {
+  std::vector<std::byte> apdu(size);
+  for (std::size_t i = 0; i < size; i++)
+    apdu[i] = static_cast<std::byte>(i);
+  return apdu;
+}
+
+atr::t1::transport make_transport(const atr::atr &atr, fake_card &card) {
+  return atr::t1::transport(
+      atr, 372, 1, 5'000'000,
+      [&card](gsl::span<const std::byte> data) { return card.send(data); },
+      [&card](gsl::span<std::byte> buffer, atr::atr::duration timeout) {
+        return card.recv(buffer, timeout);
+      });
+}
+} // namespace
+
+TEST_CASE("T=1 configuration from ATR") {
+  atr::atr atr("3B80 80 31 10 45 64"_h2b);
+  fake_card card;
+  auto transport = make_transport(atr, card);
+  REQUIRE(transport.ifsc() == 0x10);
+  REQUIRE(transport.ifsd() == 32);
+  REQUIRE(transport.code() == atr::redundancy_code::LRC);
+}
+
+TEST_CASE("T=1 exchange") {
+  atr::atr atr("3B80 80 31 10 45 64"_h2b);
+  fake_card card;
+  auto transport = make_transport(atr, card);
+  std::array<std::byte, 512> buffer;
+
+  SECTION("short APDU") {
+    const auto apdu = "00A4040000"_h2b;
+    auto response = transport.transceive(apdu, buffer);
+    REQUIRE(std::pmr::vector<std::byte>(response.begin(), response.end()) ==
+            "00A4040000 9000"_h2b);
+    REQUIRE(card.blocks_received == 1);
+  }
+  SECTION("chained in both directions") {
+    const auto apdu = make_apdu(100);
+    auto response = transport.transceive(apdu, buffer);
+    auto expected = apdu;
+    expected.push_back(std::byte{0x90});
+    expected.push_back(std::byte{0x00});
+    REQUIRE(std::vector<std::byte>(response.begin(), response.end()) ==
+            expected);
+    // 7 I-blocks (IFSC 16) + 3 R-blocks (IFSD 32)
+    REQUIRE(card.blocks_received == 10);
+  }
+  SECTION("sequence numbers over several exchanges") {
+    for (std::size_t size : {5, 40, 3, 17}) {
+      const auto apdu = make_apdu(size);
+      auto response = transport.transceive(apdu, buffer);
+      REQUIRE(response.size() == size + 2);
+      REQUIRE(std::equal(apdu.begin(), apdu.end(), response.begin()));
+    }
+  }
+  SECTION("WTX") {
+    card.wtx_requests = 2;
+    auto response = transport.transceive("0001"_h2b, buffer);
+    REQUIRE(response.size() == 4);
+    REQUIRE(card.wtx_seen == std::vector<int>{2, 2});
+  }
+  SECTION("IFS request from card") {
+    card.send_ifs = 0x20;
+    auto response = transport.transceive("0001"_h2b, buffer);
+    REQUIRE(response.size() == 4);
+    REQUIRE(transport.ifsc() == 0x20);
+  }
+  SECTION("IFS request from card, small IFSC") {
+    card.send_ifs = 0x01;
+    REQUIRE(transport.transceive("0001"_h2b, buffer).size() == 4);
+    REQUIRE(transport.ifsc() == 0x01);
+
+    // the next APDU is chained in blocks of the new IFSC
+    card.blocks_received = 0;
+    card.largest_inf = 0;
+    const auto apdu = make_apdu(10);
+    auto response = transport.transceive(apdu, buffer);
+    REQUIRE(response.size() == 12);
+    REQUIRE(std::equal(apdu.begin(), apdu.end(), response.begin()));
+    REQUIRE(card.largest_inf == 1);
+    REQUIRE(card.blocks_received == 10);
+  }
+  SECTION("IFSD negotiation") {
+    transport.negotiate_ifsd(254);
+    REQUIRE(transport.ifsd() == 254);
+    REQUIRE(card.ifsd == 254);
+    const auto apdu = make_apdu(100);
+    auto response = transport.transceive(apdu, buffer);
+    REQUIRE(response.size() == 102);
+  }
+  SECTION("retransmission after EDC error") {
+    card.corrupt_responses = 2;
+    const auto apdu = make_apdu(50);
+    auto response = transport.transceive(apdu, buffer);
+    REQUIRE(response.size() == 52);
+    REQUIRE(std::equal(apdu.begin(), apdu.end(), response.begin()));
+  }
+  SECTION("I-block requested again after own R-block") {
+    // the R-block of the card requesting I(0) is corrupted, our R-block
+    // makes the card send it again
+    card.reject_blocks = 1;
+    card.corrupt_r_blocks = 1;
+    const auto apdu = make_apdu(5);
+    auto response = transport.transceive(apdu, buffer);
+    REQUIRE(response.size() == 7);
+    REQUIRE(std::equal(apdu.begin(), apdu.end(), response.begin()));
+    // I(0), R(0), I(0)
+    REQUIRE(card.blocks_received == 3);
+  }
+  SECTION("too many errors") {
+    card.corrupt_responses = 10;
+    REQUIRE_THROWS_AS(transport.transceive("0001"_h2b, buffer),
+                      atr::t1::protocol_error);
+  }
+  SECTION("response buffer too small") {
+    std::array<std::byte, 3> small;
+    REQUIRE_THROWS_AS(transport.transceive("0001"_h2b, small),
+                      atr::t1::protocol_error);
+  }
+}
@@ -0,0 +1,96 @@
+#include "atr.hpp"
+#include "virtual_card.hpp"
+
+#include "helper.hpp"
+
+#include "catch2/catch_all.hpp"
+
+namespace {
+bool read_from(atr::sim::virtual_card &card, gsl::span<std::byte> buffer) {
+  return card.read(buffer);
+}
+} // namespace
+
+TEST_CASE("virtual card answers to reset") {
+  const auto bytes = GENERATE("3b00"_h2b, "3b10 96"_h2b,
+                              "3BE0 000081 31 FE45 EB"_h2b);
+  atr::sim::virtual_card card(bytes);
+
+  REQUIRE(atr::receive([&](gsl::span<std::byte> buffer) {
+            return read_from(card, buffer);
+          }) == bytes);
+  REQUIRE_FALSE(card.next());
+
+  SECTION("again after reset") {
+    card.reset();
+    atr::receiver receiver([&](gsl::span<std::byte> buffer) {
+      return card.read_some(buffer);
+    });
+    std::array<std::byte, atr::max_atr_size> buffer;
+    const auto received = receiver.receive(buffer);
+    REQUIRE(std::pmr::vector<std::byte>(received.begin(), received.end()) ==
+            bytes);
+  }
+}
+
+TEST_CASE("virtual card timing") {
+  using duration = atr::sim::virtual_card::duration;
+  const auto initial_etu = duration(372.0 / 5'000'000);
+  atr::sim::virtual_card card("3b02 1122"_h2b);
+
+  SECTION("ATR") {
+    const auto TS = card.next();
+    REQUIRE(TS);
+    REQUIRE(TS->at.count() == Catch::Approx(10'000.0 / 5'000'000));
+    for (int i = 0; i < 3; i++) {
+      const auto previous = card.now();
+      const auto c = card.next();
+      REQUIRE(c);
+      REQUIRE((c->at - previous).count() ==
+              Catch::Approx((12 * initial_etu).count()));
+    }
+  }
+
+  SECTION("response spaced by GT") {
+    while (card.next())
+      ;
+    const auto end_of_atr = card.now();
+    card.respond("ff1096"_h2b, 372, 1);
+    const auto first = card.next();
+    REQUIRE(first);
+    REQUIRE((first->at - end_of_atr).count() ==
+            Catch::Approx((12 * initial_etu).count()));
+    const auto second = card.next();
+    REQUIRE((second->at - first->at).count() ==
+            Catch::Approx((12 * initial_etu).count()));
+  }
+}
+
+TEST_CASE("virtual card faults") {
+  const auto bytes = "3BE0 000081 31 FE45 EB"_h2b;
+  atr::sim::virtual_card card(bytes);
+  auto read = [&](gsl::span<std::byte> buffer) {
+    return read_from(card, buffer);
+  };
+
+  SECTION("truncation") {
+    card.inject(atr::sim::fault::truncation, 4);
+    REQUIRE(atr::receive(read).empty());
+  }
+  SECTION("noise before TS") {
+    card.inject(atr::sim::fault::noise, 1);
+    const auto received = atr::receive(read);
+    REQUIRE(received != bytes);
+  }
+  SECTION("bad TCK") {
+    card.inject(atr::sim::fault::bad_tck);
+    const auto received = atr::receive(read);
+    REQUIRE(received.size() == bytes.size());
+    REQUIRE_THROWS_AS(atr::atr(received), atr::invalid_atr);
+  }
+  SECTION("cleared") {
+    card.inject(atr::sim::fault::bad_tck);
+    card.inject(atr::sim::fault::none);
+    REQUIRE(atr::atr(atr::receive(read)).bytes() == bytes);
+  }
+}